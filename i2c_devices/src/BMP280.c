@@ -2,92 +2,391 @@
 #include <zephyr/drivers/i2c.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/kernel.h>
-#include "bmp280.h"
+#include <zephyr/shell/shell.h>
+#include <string.h>
+#include <stdlib.h>
+#include "BMP280.h"
+#include "BMP280_comp.h"
 #include "i2c.h"
 
-// Calibration parameters
-uint16_t dig_T1;
-int16_t dig_T2, dig_T3;
-uint16_t dig_P1;
-int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
-int32_t t_fine;
+#define BMP280_STARTUP_MS     2  // Datasheet start-up time
+#define BMP280_NVM_COPY_POLLS 10
 
-void bmp280_init(const struct device *i2c_dev) {
+struct bmp280 {
+    // Everything a sample touches sits together at the front
+    struct bmp280_calib calib;
+    struct k_mutex lock; // Over the settings and the read state, which the shell may change
+    const struct device *i2c_dev;
+    uint8_t addr;
+    struct bmp280_raw last;     // Handed out again, marked stale, until there is new data
+    int64_t next_data_us;       // Normal mode: from here on a read is sure to find a new conversion
+    bool triggered;             // Forced mode: a conversion was started since the last read
+    bool has_sample;
+    enum bmp280_profile profile;
+    uint32_t conversion_us;
+    uint32_t period_us;         // Normal mode: worst-case conversion plus standby
+    uint32_t reads;
+    uint32_t stale_reads;       // Answered from last without touching the bus
+};
+
+struct bmp280_profile_cfg {
+    const char *name;
+    uint8_t osrs_t;
+    uint8_t osrs_p;
+    uint8_t filter; // IIR coefficient 2^filter, 0 = off
+    uint8_t t_sb;   // Standby between normal mode conversions, 0 = 0.5 ms, 1 = 62.5 ms
+    uint8_t mode;
+};
+
+static const struct bmp280_profile_cfg profiles[] = {
+    [BMP280_PROFILE_ULTRA_LOW_POWER] = { "ulp", BMP280_OSRS_X1, BMP280_OSRS_X1, 0, 0, BMP280_MODE_FORCED },
+    [BMP280_PROFILE_INDOOR_NAV] = { "nav", BMP280_OSRS_X2, BMP280_OSRS_X16, 4, 0, BMP280_MODE_NORMAL },
+    [BMP280_PROFILE_HIGH_RES] = { "hires", BMP280_OSRS_X2, BMP280_OSRS_X16, 2, 1, BMP280_MODE_NORMAL },
+};
+
+// Standby time for each t_sb setting
+static const uint32_t t_sb_us[] = { 500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000 };
+
+// Added by bmp280_init() before the acquisition threads start, then each
+// instance is used by the thread of its own bus and the shell
+static struct bmp280 instances[CONFIG_APP_BMP280_MAX_INSTANCES];
+static size_t num_instances;
+
+static uint8_t ctrl_meas_value(const struct bmp280_profile_cfg *cfg, uint8_t mode) {
+    return (cfg->osrs_t << BMP280_OSRS_T_SHIFT) | (cfg->osrs_p << BMP280_OSRS_P_SHIFT) | mode;
+}
+
+uint32_t bmp280_conversion_time_us(enum bmp280_osrs osrs_t, enum bmp280_osrs osrs_p) {
+    // t_measure,max = 1.25 + 2.3 * T oversampling + (2.3 * P oversampling + 0.575) ms
+    uint32_t us = 1250;
+
+    if (osrs_t != BMP280_OSRS_SKIP) {
+        us += 2300 << (osrs_t - 1);
+    }
+    if (osrs_p != BMP280_OSRS_SKIP) {
+        us += (2300 << (osrs_p - 1)) + 575;
+    }
+    return us;
+}
+
+static int64_t uptime_us(void) {
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+// After a reset the trimming parameters are copied from NVM, during which im_update is set
+static int wait_nvm_copy(const struct device *i2c_dev, uint8_t addr) {
+    uint8_t status;
+
+    for (int i = 0; i < BMP280_NVM_COPY_POLLS; i++) {
+        k_sleep(K_MSEC(BMP280_STARTUP_MS));
+        int ret = i2c_read_register(i2c_dev, addr, BMP280_REG_STATUS, &status);
+        if (ret == 0 && !(status & BMP280_STATUS_IM_UPDATE)) {
+            return 0;
+        }
+    }
+    return -ETIMEDOUT;
+}
+
+struct bmp280 *bmp280_init(const struct device *i2c_dev, uint8_t addr) {
+    struct bmp280 *bmp = NULL;
     uint8_t chip_id;
 
+    for (size_t i = 0; i < num_instances; i++) {
+        if (instances[i].i2c_dev == i2c_dev && instances[i].addr == addr) {
+            bmp = &instances[i];
+        }
+    }
+    if (bmp == NULL) {
+        if (num_instances >= ARRAY_SIZE(instances)) {
+            printk("Error: No room for BMP280 0x%02x, raise CONFIG_APP_BMP280_MAX_INSTANCES\n", addr);
+            return NULL;
+        }
+        bmp = &instances[num_instances];
+        k_mutex_init(&bmp->lock);
+    }
+
     // Read Chip ID
-    if (i2c_read_register(i2c_dev, BMP280_ADDR, BMP280_REG_CHIPID, &chip_id) != 0 || chip_id != 0x58) {
-        printk("Error: BMP280 not detected or invalid Chip ID\n");
-        return;
+    if (i2c_read_register(i2c_dev, addr, BMP280_REG_CHIPID, &chip_id) != 0 || chip_id != 0x58) {
+        printk("Error: BMP280 0x%02x not detected or invalid Chip ID\n", addr);
+        return NULL;
     }
-    printk("BMP280 detected. Chip ID: 0x%x\n", chip_id);
+    printk("BMP280 0x%02x detected on %s. Chip ID: 0x%x\n", addr, i2c_dev->name, chip_id);
 
     // Reset the sensor
-    i2c_write_register(i2c_dev, BMP280_ADDR, BMP280_REG_SOFTRESET, 0xB6);
-    k_sleep(K_MSEC(100));
+    i2c_write_register(i2c_dev, addr, BMP280_REG_SOFTRESET, 0xB6);
+    i2c_shadow_invalidate(i2c_dev, addr); // Registers are back to their reset values
+    if (wait_nvm_copy(i2c_dev, addr) != 0) {
+        printk("Error: BMP280 0x%02x did not come out of reset\n", addr);
+        return NULL;
+    }
 
     // Read calibration data
     uint8_t calib_data[24];
-    if (i2c_read_registers(i2c_dev, BMP280_ADDR, BMP280_REG_CALIB_START, calib_data, sizeof(calib_data)) != 0) {
+    if (i2c_read_registers(i2c_dev, addr, BMP280_REG_CALIB_START, calib_data, sizeof(calib_data)) != 0) {
         printk("Error: Failed to read calibration data\n");
-        return;
+        return NULL;
     }
 
+    k_mutex_lock(&bmp->lock, K_FOREVER);
+
     // Parse calibration data
-    dig_T1 = (calib_data[1] << 8) | calib_data[0];
-    dig_T2 = (calib_data[3] << 8) | calib_data[2];
-    dig_T3 = (calib_data[5] << 8) | calib_data[4];
-    dig_P1 = (calib_data[7] << 8) | calib_data[6];
-    dig_P2 = (calib_data[9] << 8) | calib_data[8];
-    dig_P3 = (calib_data[11] << 8) | calib_data[10];
-    dig_P4 = (calib_data[13] << 8) | calib_data[12];
-    dig_P5 = (calib_data[15] << 8) | calib_data[14];
-    dig_P6 = (calib_data[17] << 8) | calib_data[16];
-    dig_P7 = (calib_data[19] << 8) | calib_data[18];
-    dig_P8 = (calib_data[21] << 8) | calib_data[20];
-    dig_P9 = (calib_data[23] << 8) | calib_data[22];
-
-    // Configure sensor: normal mode, oversampling x1 for temp & pressure
-    uint8_t ctrl_meas = (0x01 << 5) | (0x01 << 2) | 0x03;
-    i2c_write_register(i2c_dev, BMP280_ADDR, BMP280_REG_CONTROL, ctrl_meas);
-    i2c_write_register(i2c_dev, BMP280_ADDR, BMP280_REG_CONFIG, 0);
-}
-
-void read_bmp280_data(const struct device *i2c_dev) {
+    struct bmp280_calib *calib = &bmp->calib;
+    calib->dig_T1 = (calib_data[1] << 8) | calib_data[0];
+    calib->dig_T2 = (calib_data[3] << 8) | calib_data[2];
+    calib->dig_T3 = (calib_data[5] << 8) | calib_data[4];
+    calib->dig_P1 = (calib_data[7] << 8) | calib_data[6];
+    calib->dig_P2 = (calib_data[9] << 8) | calib_data[8];
+    calib->dig_P3 = (calib_data[11] << 8) | calib_data[10];
+    calib->dig_P4 = (calib_data[13] << 8) | calib_data[12];
+    calib->dig_P5 = (calib_data[15] << 8) | calib_data[14];
+    calib->dig_P6 = (calib_data[17] << 8) | calib_data[16];
+    calib->dig_P7 = (calib_data[19] << 8) | calib_data[18];
+    calib->dig_P8 = (calib_data[21] << 8) | calib_data[20];
+    calib->dig_P9 = (calib_data[23] << 8) | calib_data[22];
+
+    bmp->i2c_dev = i2c_dev;
+    bmp->addr = addr;
+    bmp->has_sample = false;
+    bmp->reads = 0;
+    bmp->stale_reads = 0;
+    int ret = bmp280_set_profile(bmp, CONFIG_APP_BMP280_PROFILE_ID);
+    k_mutex_unlock(&bmp->lock);
+    if (ret != 0) {
+        printk("Error: Failed to configure BMP280 0x%02x\n", addr);
+        return NULL;
+    }
+
+    if (bmp == &instances[num_instances]) {
+        num_instances++;
+    }
+    return bmp;
+}
+
+int bmp280_set_profile(struct bmp280 *bmp, enum bmp280_profile profile) {
+    if (profile >= ARRAY_SIZE(profiles)) {
+        return -EINVAL;
+    }
+
+    const struct bmp280_profile_cfg *cfg = &profiles[profile];
+    // config writes may be ignored in normal mode, so sleep first and only then
+    // start normal mode. A forced profile stays asleep until
+    // bmp280_start(), which is also what the shadow then holds.
+    struct i2c_reg_pair pairs[] = {
+        { BMP280_REG_CONTROL, ctrl_meas_value(cfg, BMP280_MODE_SLEEP) },
+        { BMP280_REG_CONFIG, (cfg->t_sb << BMP280_T_SB_SHIFT) | (cfg->filter << BMP280_FILTER_SHIFT) },
+        { BMP280_REG_CONTROL, ctrl_meas_value(cfg, cfg->mode) },
+    };
+    size_t count = cfg->mode == BMP280_MODE_FORCED ? 2 : 3;
+
+    k_mutex_lock(&bmp->lock, K_FOREVER);
+    int ret = i2c_write_register_pairs(bmp->i2c_dev, bmp->addr, pairs, count);
+    if (ret != 0) {
+        k_mutex_unlock(&bmp->lock);
+        return ret;
+    }
+
+    bmp->profile = profile;
+    bmp->conversion_us = bmp280_conversion_time_us(cfg->osrs_t, cfg->osrs_p);
+    bmp->period_us = bmp->conversion_us + t_sb_us[cfg->t_sb];
+    // Normal mode starts converting right away, the first result is in after one conversion
+    bmp->next_data_us = uptime_us() + bmp->conversion_us;
+    bmp->triggered = false;
+    printk("BMP280 0x%02x profile %s: osrs_t %u, osrs_p %u, filter %u, t_sb %u, %u us per conversion\n", bmp->addr,
+           cfg->name, cfg->osrs_t, cfg->osrs_p, cfg->filter, cfg->t_sb, bmp->conversion_us);
+    k_mutex_unlock(&bmp->lock);
+    return 0;
+}
+
+enum bmp280_profile bmp280_get_profile(const struct bmp280 *bmp) {
+    return bmp->profile;
+}
+
+int bmp280_start(struct bmp280 *bmp) {
+    k_mutex_lock(&bmp->lock, K_FOREVER);
+
+    const struct bmp280_profile_cfg *cfg = &profiles[bmp->profile];
+    int ret = 0;
+
+    // A trigger, not a setting: the sensor drops back to sleep mode when the
+    // conversion is done, so it is written plainly and the shadow keeps sleep
+    if (cfg->mode == BMP280_MODE_FORCED) {
+        ret = i2c_write_register(bmp->i2c_dev, bmp->addr, BMP280_REG_CONTROL, ctrl_meas_value(cfg, BMP280_MODE_FORCED));
+        if (ret == 0) {
+            bmp->triggered = true;
+            ret = bmp->conversion_us;
+        }
+    }
+
+    k_mutex_unlock(&bmp->lock);
+    return ret;
+}
+
+static int read_raw_locked(struct bmp280 *bmp, struct bmp280_raw *raw) {
     uint8_t data[6];
+    int64_t now_us = uptime_us();
 
-    if (i2c_read_registers(i2c_dev, BMP280_ADDR, BMP280_REG_PRESSURE_MSB, data, sizeof(data)) != 0) {
-        printk("Error: Failed to read BMP280 data\n");
-        return;
+    bmp->reads++;
+
+    // Any window of a whole worst-case period holds the end of a conversion,
+    // so a read that waits that long never gets the same data twice
+    bool new_data = (profiles[bmp->profile].mode == BMP280_MODE_FORCED) ? bmp->triggered : now_us >= bmp->next_data_us;
+    if (!new_data) {
+        bmp->stale_reads++;
+        if (!bmp->has_sample) {
+            return -EAGAIN;
+        }
+        *raw = bmp->last;
+        raw->fresh = false;
+        return 0;
+    }
+
+    int ret = i2c_read_registers(bmp->i2c_dev, bmp->addr, BMP280_REG_PRESSURE_MSB, data, sizeof(data));
+    if (ret != 0) {
+        return ret;
+    }
+    bmp->triggered = false;
+    bmp->next_data_us = now_us + bmp->period_us;
+
+    raw->timestamp_us = now_us;
+    raw->adc_T = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+    raw->adc_P = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+    raw->fresh = true;
+    bmp->last = *raw;
+    bmp->has_sample = true;
+    return 0;
+}
+
+int bmp280_read_raw(struct bmp280 *bmp, struct bmp280_raw *raw) {
+    k_mutex_lock(&bmp->lock, K_FOREVER);
+    int ret = read_raw_locked(bmp, raw);
+    k_mutex_unlock(&bmp->lock);
+    return ret;
+}
+
+const struct bmp280_calib *bmp280_get_calib(const struct bmp280 *bmp) {
+    return &bmp->calib;
+}
+
+int bmp280_read(struct bmp280 *bmp, struct bmp280_sample *sample) {
+    struct bmp280_raw raw;
+
+    int ret = bmp280_read_raw(bmp, &raw);
+    if (ret != 0) {
+        return ret;
     }
 
-    int32_t adc_T = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
-    int32_t adc_P = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+    sample->timestamp_us = raw.timestamp_us;
+    sample->fresh = raw.fresh;
+    return bmp280_compensate(CONFIG_APP_BMP280_COMP_ID, &bmp->calib, raw.adc_T, raw.adc_P, &sample->temperature_centi_c,
+                             &sample->pressure_q24_8);
+}
 
-    // Temperature compensation
-    int32_t var1 = ((((adc_T >> 3) - ((int32_t)dig_T1 << 1))) * ((int32_t)dig_T2)) >> 11;
-    int32_t var2 = (((((adc_T >> 4) - ((int32_t)dig_T1)) * ((adc_T >> 4) - ((int32_t)dig_T1))) >> 12) * ((int32_t)dig_T3)) >> 14;
-    t_fine = var1 + var2;
-    float celsius = ((t_fine * 5 + 128) >> 8) / 100.0f;
-    float fahrenheit =(celsius *  1.8) + 32.0;
+int bmp280_start_measurement(const struct device *i2c_dev, void *ctx) {
+    struct bmp280 *bmp = ctx;
 
-    // Pressure compensation
-    int64_t var1_p = ((int64_t)t_fine) - 128000;
-    int64_t var2_p = var1_p * var1_p * (int64_t)dig_P6 + ((var1_p * (int64_t)dig_P5) << 17) + (((int64_t)dig_P4) << 35);
-    var1_p = (((var1_p * var1_p * (int64_t)dig_P3) >> 8) + ((var1_p * (int64_t)dig_P2) << 12));
-    var1_p = ((((int64_t)1 << 47) + var1_p) * (int64_t)dig_P1) >> 33;
+    // NULL if bmp280_init() failed
+    if (bmp == NULL) {
+        return -ENODEV;
+    }
+    return bmp280_start(bmp);
+}
 
-    if (var1_p == 0) {
-        printk("Error: Division by zero in pressure calculation\n");
+void read_bmp280_data(const struct device *i2c_dev, void *ctx) {
+    struct bmp280 *bmp = ctx;
+    struct bmp280_sample sample;
+
+    if (bmp == NULL) {
+        return;
+    }
+
+    int ret = bmp280_read(bmp, &sample);
+    if (ret == -ERANGE) {
+        printk("Error: Division by zero in BMP280 0x%02x pressure calculation\n", bmp->addr);
+        return;
+    }
+    if (ret == -EAGAIN || (ret == 0 && !sample.fresh)) {
+        return; // Nothing new since the last print
+    }
+    if (ret != 0) {
+        printk("Error: Failed to read BMP280 0x%02x data\n", bmp->addr);
         return;
     }
 
-    int64_t p = ((((int64_t)1048576 - adc_P) << 31) - var2_p) * 3125 / var1_p;
-    var1_p = (((int64_t)dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-    var2_p = (((int64_t)dig_P8) * p) >> 19;
-    p = ((p + var1_p + var2_p) >> 8) + (((int64_t)dig_P7) << 4);
+    float celsius = sample.temperature_centi_c / 100.0f;
+    float fahrenheit = (celsius * 1.8) + 32.0;
+    float pressure = sample.pressure_q24_8 / 25600.0f; // Convert to hPa
+
+    printk("BMP280 0x%02x Temperature: %.2f °C / %.2f °F, Pressure: %.2f hPa\n", bmp->addr, celsius, fahrenheit,
+           pressure);
+}
+
+#ifdef CONFIG_SHELL
+
+static int cmd_bmp280_profile(const struct shell *sh, size_t argc, char **argv) {
+    if (argc < 2) {
+        for (size_t i = 0; i < num_instances; i++) {
+            struct bmp280 *bmp = &instances[i];
+
+            k_mutex_lock(&bmp->lock, K_FOREVER);
+            shell_print(sh, "BMP280 %s 0x%02x profile: %s, %u us per conversion, %u of %u reads stale",
+                        bmp->i2c_dev->name, bmp->addr, profiles[bmp->profile].name, bmp->conversion_us,
+                        bmp->stale_reads, bmp->reads);
+            k_mutex_unlock(&bmp->lock);
+        }
+        return 0;
+    }
+    if (num_instances == 0) {
+        shell_error(sh, "BMP280 not initialized");
+        return -ENODEV;
+    }
+
+    for (size_t p = 0; p < ARRAY_SIZE(profiles); p++) {
+        if (strcmp(argv[1], profiles[p].name) == 0) {
+            for (size_t i = 0; i < num_instances; i++) {
+                int ret = bmp280_set_profile(&instances[i], p);
+                if (ret != 0) {
+                    shell_error(sh, "Failed to set profile on 0x%02x (%d)", instances[i].addr, ret);
+                    return ret;
+                }
+            }
+            return 0;
+        }
+    }
+
+    shell_error(sh, "Unknown profile, use ulp, nav or hires");
+    return -EINVAL;
+}
+
+SHELL_CMD_ARG_REGISTER(bmp280_profile, NULL, "Show or set the measurement profile of every BMP280 [ulp|nav|hires]",
+                       cmd_bmp280_profile, 1, 1);
 
-    float pressure = p / 25600.0f;  // Convert to hPa
+#ifdef CONFIG_APP_BMP280_COMP_BENCH
+
+static int cmd_bmp280_bench(const struct shell *sh, size_t argc, char **argv) {
+    static const char *const names[] = { "int64", "int32", "float" };
+    uint32_t n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    struct bmp280_comp_bench bench[BMP280_COMP_COUNT];
+
+    if (n == 0) {
+        return -EINVAL;
+    }
 
-    printk("Temperature: %.2f °C / %.2f °F, Pressure: %.2f hPa\n", celsius, fahrenheit, pressure);
+    // The first sensor's calibration, or the datasheet example without one
+    const struct bmp280_calib *calib = num_instances > 0 ? &instances[0].calib : &bmp280_datasheet_calib;
+
+    bmp280_comp_benchmark(calib, n, bench);
+    shell_print(sh, "impl   samples  cycles/sample  ns/sample  max err mdegC  max err mPa");
+    for (int i = 0; i < BMP280_COMP_COUNT; i++) {
+        shell_print(sh, "%-5s  %7u  %13u  %9u  %13u  %11u%s", names[i], bench[i].samples, bench[i].cycles_per_sample,
+                    bench[i].ns_per_sample, bench[i].max_temp_err_mc, bench[i].max_press_err_mpa,
+                    i == CONFIG_APP_BMP280_COMP_ID ? "  (live)" : "");
+    }
+    return 0;
 }
+
+SHELL_CMD_ARG_REGISTER(bmp280_bench, NULL, "Time and check the BMP280 compensation variants [samples]",
+                       cmd_bmp280_bench, 1, 1);
+
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #include <zephyr/sys/printk.h>
 #include <zephyr/kernel.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 // HOW TO CONNECT: (BMP --> Nordic)
 // SCK --> Pin 27
@@ -15,18 +16,98 @@
 // 3Vo --> VDD
 // GND --> GND
 
-#define BMP280_ADDR 0x76  // Adjust to 0x77 if SDO pin is high
+#define BMP280_ADDR           0x76  // SDO low
+#define BMP280_ADDR_SECONDARY 0x77  // SDO high
 
 // BMP280 Register Addresses
 #define BMP280_REG_CALIB_START    0x88
 #define BMP280_REG_CHIPID         0xD0
 #define BMP280_REG_SOFTRESET      0xE0
+#define BMP280_REG_STATUS         0xF3
 #define BMP280_REG_CONTROL        0xF4
 #define BMP280_REG_CONFIG         0xF5
 #define BMP280_REG_PRESSURE_MSB   0xF7
 #define BMP280_REG_TEMPERATURE_MSB 0xFA
 
-void bmp280_init(const struct device *i2c_dev);
-void read_bmp280_data(const struct device *i2c_dev);
+// ctrl_meas (BMP280_REG_CONTROL) and config fields
+#define BMP280_OSRS_T_SHIFT  5
+#define BMP280_OSRS_P_SHIFT  2
+#define BMP280_MODE_MASK     0x03
+#define BMP280_MODE_SLEEP    0x00
+#define BMP280_MODE_FORCED   0x01
+#define BMP280_MODE_NORMAL   0x03
+#define BMP280_T_SB_SHIFT    5
+#define BMP280_FILTER_SHIFT  2
+#define BMP280_STATUS_MEASURING 0x08
+#define BMP280_STATUS_IM_UPDATE 0x01
+
+// Oversampling settings, osrs_t / osrs_p
+enum bmp280_osrs {
+    BMP280_OSRS_SKIP,
+    BMP280_OSRS_X1,
+    BMP280_OSRS_X2,
+    BMP280_OSRS_X4,
+    BMP280_OSRS_X8,
+    BMP280_OSRS_X16,
+};
+
+// Measurement profiles after the datasheet's recommended settings, section 3.8.2
+enum bmp280_profile {
+    BMP280_PROFILE_ULTRA_LOW_POWER, // Forced one-shot per tick, x1/x1, no IIR
+    BMP280_PROFILE_INDOOR_NAV,      // Normal mode, p x16 / t x2, IIR 16, 0.5 ms standby
+    BMP280_PROFILE_HIGH_RES,        // Normal mode, p x16 / t x2, IIR 4, 62.5 ms standby
+};
+
+// One BMP280 at one (bus, address), with its own calibration and settings.
+// Instances come from a pool of CONFIG_APP_BMP280_MAX_INSTANCES and are
+// set up before acquisition starts. Each has a lock, so its bus thread and
+// the shell can both use it afterwards.
+struct bmp280;
+struct bmp280_calib;
+
+struct bmp280_sample {
+    int64_t timestamp_us;        // System uptime when the data was read
+    int32_t temperature_centi_c; // 0.01 degC
+    uint32_t pressure_q24_8;     // Pa, 8 fractional bits
+    bool fresh;                  // From a conversion no earlier sample came from
+};
+
+// The data registers as read, before compensation
+struct bmp280_raw {
+    int64_t timestamp_us;
+    int32_t adc_T;
+    int32_t adc_P;
+    bool fresh;
+};
+
+// Detect, reset and configure the sensor at addr. Returns NULL if it is not
+// there. Calling it again for the same bus and address reinitializes that instance.
+struct bmp280 *bmp280_init(const struct device *i2c_dev, uint8_t addr);
+
+// Write oversampling, IIR filter and standby time in one batched transfer
+int bmp280_set_profile(struct bmp280 *bmp, enum bmp280_profile profile);
+enum bmp280_profile bmp280_get_profile(const struct bmp280 *bmp);
+
+// Worst-case conversion time from the datasheet, section 3.8.1
+uint32_t bmp280_conversion_time_us(enum bmp280_osrs osrs_t, enum bmp280_osrs osrs_p);
+
+// In forced mode, start a conversion and return the microseconds until it is
+// done. Returns 0 in normal mode, where the sensor converts on its own and
+// bmp280_read_raw() tells from the conversion period whether there is new data.
+int bmp280_start(struct bmp280 *bmp);
+// Burst-read the data registers and compensate them, but only if the sensor
+// has finished a conversion since the last read: in forced mode one was
+// started, in normal mode a whole worst-case conversion and standby period
+// has passed. Otherwise the bus is left alone and the last sample is returned
+// again with fresh cleared. Returns -EAGAIN before the first sample.
+int bmp280_read(struct bmp280 *bmp, struct bmp280_sample *sample);
+// The same without the compensation, for decoding later with the calibration
+int bmp280_read_raw(struct bmp280 *bmp, struct bmp280_raw *raw);
+const struct bmp280_calib *bmp280_get_calib(const struct bmp280 *bmp);
+
+// Acquisition hooks for the instance from bmp280_init() in ctx: start
+// returns its wait, read prints a fresh sample
+int bmp280_start_measurement(const struct device *i2c_dev, void *ctx);
+void read_bmp280_data(const struct device *i2c_dev, void *ctx);
 
 #endif
\ No newline at end of file
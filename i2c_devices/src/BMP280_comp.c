@@ -0,0 +1,257 @@
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <errno.h>
+#include <string.h>
+#include "BMP280_comp.h"
+
+#define BENCH_SAMPLES  64 // Readings made up per timed block
+#define BENCH_ATTEMPTS 64 // Random readings tried per value before giving up on a sample
+
+const struct bmp280_calib bmp280_datasheet_calib = {
+    27504, 26435, -1000,
+    36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000,
+};
+
+// Temperature in 0.01 degC, and t_fine for the pressure compensation.
+// Shared by both integer variants.
+static int32_t compensate_temperature(const struct bmp280_calib *c, int32_t adc_T, int32_t *t_fine) {
+    int32_t var1 = ((((adc_T >> 3) - ((int32_t)c->dig_T1 << 1))) * ((int32_t)c->dig_T2)) >> 11;
+    int32_t var2 = (((((adc_T >> 4) - ((int32_t)c->dig_T1)) * ((adc_T >> 4) - ((int32_t)c->dig_T1))) >> 12) *
+                    ((int32_t)c->dig_T3)) >> 14;
+    *t_fine = var1 + var2;
+    return (*t_fine * 5 + 128) >> 8;
+}
+
+// Pressure in Pa as Q24.8, or 0 if the calibration would divide by zero
+static uint32_t compensate_pressure_int64(const struct bmp280_calib *c, int32_t adc_P, int32_t t_fine) {
+    int64_t var1_p = ((int64_t)t_fine) - 128000;
+    int64_t var2_p = var1_p * var1_p * (int64_t)c->dig_P6 + ((var1_p * (int64_t)c->dig_P5) << 17) +
+                     (((int64_t)c->dig_P4) << 35);
+    var1_p = (((var1_p * var1_p * (int64_t)c->dig_P3) >> 8) + ((var1_p * (int64_t)c->dig_P2) << 12));
+    var1_p = ((((int64_t)1 << 47) + var1_p) * (int64_t)c->dig_P1) >> 33;
+
+    if (var1_p == 0) {
+        return 0;
+    }
+
+    int64_t p = ((((int64_t)1048576 - adc_P) << 31) - var2_p) * 3125 / var1_p;
+    var1_p = (((int64_t)c->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2_p = (((int64_t)c->dig_P8) * p) >> 19;
+    return (uint32_t)(((p + var1_p + var2_p) >> 8) + (((int64_t)c->dig_P7) << 4));
+}
+
+// Pressure in whole Pa, or 0 if the calibration would divide by zero. Only
+// 32-bit multiplies and one 32-bit divide, at about 1 Pa of resolution.
+static uint32_t compensate_pressure_int32(const struct bmp280_calib *c, int32_t adc_P, int32_t t_fine) {
+    int32_t var1 = (t_fine >> 1) - 64000;
+    int32_t var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t)c->dig_P6);
+    var2 = var2 + ((var1 * ((int32_t)c->dig_P5)) << 1);
+    var2 = (var2 >> 2) + (((int32_t)c->dig_P4) << 16);
+    var1 = (((c->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((int32_t)c->dig_P2) * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * ((int32_t)c->dig_P1)) >> 15;
+
+    if (var1 == 0) {
+        return 0;
+    }
+
+    uint32_t p = ((uint32_t)(1048576 - adc_P) - (var2 >> 12)) * 3125;
+    if (p < 0x80000000) {
+        p = (p << 1) / (uint32_t)var1;
+    } else {
+        p = (p / (uint32_t)var1) * 2;
+    }
+    var1 = (((int32_t)c->dig_P9) * ((int32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+    var2 = (((int32_t)(p >> 2)) * ((int32_t)c->dig_P8)) >> 13;
+    return (uint32_t)((int32_t)p + ((var1 + var2 + c->dig_P7) >> 4));
+}
+
+// Temperature in degC and pressure in Pa. Returns false if the calibration would divide by zero.
+static bool compensate_float(const struct bmp280_calib *c, int32_t adc_T, int32_t adc_P, float *temp, float *press) {
+    float var1 = ((float)adc_T / 16384.0f - (float)c->dig_T1 / 1024.0f) * (float)c->dig_T2;
+    float var2 = ((float)adc_T / 131072.0f - (float)c->dig_T1 / 8192.0f);
+    var2 = var2 * var2 * (float)c->dig_T3;
+    float t_fine = var1 + var2;
+    *temp = t_fine / 5120.0f;
+
+    var1 = t_fine / 2.0f - 64000.0f;
+    var2 = var1 * var1 * (float)c->dig_P6 / 32768.0f;
+    var2 = var2 + var1 * (float)c->dig_P5 * 2.0f;
+    var2 = var2 / 4.0f + (float)c->dig_P4 * 65536.0f;
+    var1 = ((float)c->dig_P3 * var1 * var1 / 524288.0f + (float)c->dig_P2 * var1) / 524288.0f;
+    var1 = (1.0f + var1 / 32768.0f) * (float)c->dig_P1;
+
+    if (var1 == 0.0f) {
+        return false;
+    }
+
+    float p = 1048576.0f - (float)adc_P;
+    p = (p - var2 / 4096.0f) * 6250.0f / var1;
+    var1 = (float)c->dig_P9 * p * p / 2147483648.0f;
+    var2 = p * (float)c->dig_P8 / 32768.0f;
+    *press = p + (var1 + var2 + (float)c->dig_P7) / 16.0f;
+    return true;
+}
+
+int bmp280_compensate(enum bmp280_comp comp, const struct bmp280_calib *calib, int32_t adc_T, int32_t adc_P,
+                      int32_t *temperature_centi_c, uint32_t *pressure_q24_8) {
+    int32_t t_fine;
+    float temp, press;
+
+    switch (comp) {
+    case BMP280_COMP_INT64:
+        *temperature_centi_c = compensate_temperature(calib, adc_T, &t_fine);
+        *pressure_q24_8 = compensate_pressure_int64(calib, adc_P, t_fine);
+        break;
+    case BMP280_COMP_INT32:
+        *temperature_centi_c = compensate_temperature(calib, adc_T, &t_fine);
+        *pressure_q24_8 = compensate_pressure_int32(calib, adc_P, t_fine) << 8;
+        break;
+    case BMP280_COMP_FLOAT:
+        if (!compensate_float(calib, adc_T, adc_P, &temp, &press)) {
+            return -ERANGE;
+        }
+        *temperature_centi_c = (int32_t)(temp * 100.0f + (temp < 0.0f ? -0.5f : 0.5f));
+        *pressure_q24_8 = (uint32_t)(press * 256.0f + 0.5f);
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return *pressure_q24_8 == 0 ? -ERANGE : 0;
+}
+
+#ifdef CONFIG_APP_BMP280_COMP_BENCH
+
+// The datasheet's double precision formula, section 8.1, as the reference
+static bool compensate_double(const struct bmp280_calib *c, int32_t adc_T, int32_t adc_P, double *temp, double *press) {
+    double var1 = ((double)adc_T / 16384.0 - (double)c->dig_T1 / 1024.0) * (double)c->dig_T2;
+    double var2 = ((double)adc_T / 131072.0 - (double)c->dig_T1 / 8192.0);
+    var2 = var2 * var2 * (double)c->dig_T3;
+    // The pressure formula takes t_fine as the integer the other variants use
+    double t_fine = (int32_t)(var1 + var2);
+    *temp = (var1 + var2) / 5120.0;
+
+    var1 = t_fine / 2.0 - 64000.0;
+    var2 = var1 * var1 * (double)c->dig_P6 / 32768.0;
+    var2 = var2 + var1 * (double)c->dig_P5 * 2.0;
+    var2 = var2 / 4.0 + (double)c->dig_P4 * 65536.0;
+    var1 = ((double)c->dig_P3 * var1 * var1 / 524288.0 + (double)c->dig_P2 * var1) / 524288.0;
+    var1 = (1.0 + var1 / 32768.0) * (double)c->dig_P1;
+
+    if (var1 == 0.0) {
+        return false;
+    }
+
+    double p = 1048576.0 - (double)adc_P;
+    p = (p - var2 / 4096.0) * 6250.0 / var1;
+    var1 = (double)c->dig_P9 * p * p / 2147483648.0;
+    var2 = p * (double)c->dig_P8 / 32768.0;
+    *press = p + (var1 + var2 + (double)c->dig_P7) / 16.0;
+    return true;
+}
+
+static uint32_t xorshift32(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+struct bench_reading {
+    int32_t adc_T;
+    int32_t adc_P;
+    double temp;
+    double press;
+    bool valid; // Inside the operating range, counted in the error
+};
+
+static bool temp_in_range(const struct bench_reading *r) {
+    return r->temp >= -40.0 && r->temp <= 85.0;
+}
+
+static bool press_in_range(const struct bench_reading *r) {
+    return r->press >= 30000.0 && r->press <= 110000.0;
+}
+
+// Draw the temperature reading first and then a pressure reading that fits it
+static void bench_reading(const struct bmp280_calib *calib, uint32_t *rng, struct bench_reading *r) {
+    r->adc_P = 0x80000;
+    r->valid = false;
+
+    for (int i = 0; i < BENCH_ATTEMPTS; i++) {
+        r->adc_T = xorshift32(rng) & 0xFFFFF;
+        if (compensate_double(calib, r->adc_T, r->adc_P, &r->temp, &r->press) && temp_in_range(r)) {
+            break;
+        }
+    }
+    for (int i = 0; i < BENCH_ATTEMPTS; i++) {
+        r->adc_P = xorshift32(rng) & 0xFFFFF;
+        if (compensate_double(calib, r->adc_T, r->adc_P, &r->temp, &r->press) && temp_in_range(r) &&
+            press_in_range(r)) {
+            r->valid = true;
+            return;
+        }
+    }
+}
+
+static uint32_t abs_err_milli(double value, double ref) {
+    double err = (value - ref) * 1000.0;
+    return (uint32_t)(err < 0.0 ? -err : err);
+}
+
+void bmp280_comp_benchmark(const struct bmp280_calib *calib, uint32_t n, struct bmp280_comp_bench bench[BMP280_COMP_COUNT]) {
+    static struct bench_reading readings[BENCH_SAMPLES];
+    static int32_t temps[BENCH_SAMPLES];
+    static uint32_t pressures[BENCH_SAMPLES];
+    uint64_t cycles[BMP280_COMP_COUNT] = { 0 };
+    uint32_t rng = 0x2545F491;
+    timing_t start, end;
+
+    memset(bench, 0, BMP280_COMP_COUNT * sizeof(bench[0]));
+    if (n == 0) {
+        return;
+    }
+
+    timing_init();
+    timing_start();
+
+    // Time in blocks of BENCH_SAMPLES so making up the input and the reference is not counted
+    for (uint32_t done = 0; done < n;) {
+        uint32_t block = MIN(n - done, BENCH_SAMPLES);
+
+        for (uint32_t i = 0; i < block; i++) {
+            bench_reading(calib, &rng, &readings[i]);
+        }
+
+        for (int comp = 0; comp < BMP280_COMP_COUNT; comp++) {
+            start = timing_counter_get();
+            for (uint32_t i = 0; i < block; i++) {
+                bmp280_compensate(comp, calib, readings[i].adc_T, readings[i].adc_P, &temps[i], &pressures[i]);
+            }
+            end = timing_counter_get();
+            cycles[comp] += timing_cycles_get(&start, &end);
+
+            for (uint32_t i = 0; i < block; i++) {
+                if (!readings[i].valid) {
+                    continue;
+                }
+                bench[comp].max_temp_err_mc =
+                    MAX(bench[comp].max_temp_err_mc, abs_err_milli(temps[i] / 100.0, readings[i].temp));
+                bench[comp].max_press_err_mpa =
+                    MAX(bench[comp].max_press_err_mpa, abs_err_milli(pressures[i] / 256.0, readings[i].press));
+            }
+        }
+
+        done += block;
+    }
+
+    for (int comp = 0; comp < BMP280_COMP_COUNT; comp++) {
+        bench[comp].samples = n;
+        bench[comp].cycles_per_sample = (uint32_t)(cycles[comp] / n);
+        bench[comp].ns_per_sample = (uint32_t)(timing_cycles_to_ns(cycles[comp]) / n);
+    }
+}
+
+#endif
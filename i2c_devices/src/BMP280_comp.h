@@ -0,0 +1,49 @@
+#ifndef BMP280_COMP_H
+#define BMP280_COMP_H
+
+#include <stdint.h>
+
+// BMP280 compensation formulas from the datasheet, section 8, in three
+// variants: the 64-bit integer one, Bosch's 32-bit integer one and a float
+// one for cores with an FPU. CONFIG_APP_BMP280_COMP_* picks the one used on
+// live samples; bmp280_comp_benchmark(), built with the shell, times and
+// checks all of them.
+
+// Calibration parameters, in the order the compensation reads them
+struct bmp280_calib {
+    uint16_t dig_T1;
+    int16_t dig_T2, dig_T3;
+    uint16_t dig_P1;
+    int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+};
+
+// Example calibration from the datasheet, section 3.12, also used by the emulator
+extern const struct bmp280_calib bmp280_datasheet_calib;
+
+enum bmp280_comp {
+    BMP280_COMP_INT64,
+    BMP280_COMP_INT32,
+    BMP280_COMP_FLOAT,
+    BMP280_COMP_COUNT,
+};
+
+// Temperature in 0.01 degC and pressure in Pa as Q24.8 from the raw 20-bit
+// readings. Returns 0, or -ERANGE if the calibration would divide by zero.
+int bmp280_compensate(enum bmp280_comp comp, const struct bmp280_calib *calib, int32_t adc_T, int32_t adc_P,
+                      int32_t *temperature_centi_c, uint32_t *pressure_q24_8);
+
+struct bmp280_comp_bench {
+    uint32_t samples;
+    uint32_t cycles_per_sample;
+    uint32_t ns_per_sample;
+    uint32_t max_temp_err_mc;   // Against the double precision formula, milli-degC
+    uint32_t max_press_err_mpa; // Milli-Pa
+};
+
+// Run n random raw readings through every variant, timing each and comparing
+// it against the double precision formula. Readings are drawn from the raw
+// ADC range until they fall in the sensor's operating range, -40 to 85 degC
+// and 300 to 1100 hPa; the rare one that never does is timed but not checked.
+void bmp280_comp_benchmark(const struct bmp280_calib *calib, uint32_t n, struct bmp280_comp_bench bench[BMP280_COMP_COUNT]);
+
+#endif
@@ -14,7 +14,20 @@
 #define MLX90614_TA 0x06 // Ambient temperature register
 #define MLX90614_TOBJ1 0x07 // Object 1 temperature register
 
+// SMBus PEC check counters
+struct mlx90614_pec_stats {
+    uint32_t words;      // Words checked
+    uint32_t pec_errors; // Words that failed the check
+    uint32_t rereads;    // Extra reads issued to recover a word
+    uint32_t failures;   // Words still bad after CONFIG_APP_MLX90614_PEC_RETRIES re-reads
+};
+
+// Returns -EBADMSG if every read of the word failed the PEC check
 int read_mlx90614_register(const struct device *i2c_dev, uint8_t reg_addr, uint16_t *data);
-void read_mlx90614_data(const struct device *i2c_dev);
+// Ambient and object words, 0.02 K per LSB, PEC checked. Returns -EBADMSG as above.
+int mlx90614_read_raw(const struct device *i2c_dev, uint16_t *ambient_raw, uint16_t *object_raw);
+// Acquisition reader, ctx is unused as there is only one MLX90614
+void read_mlx90614_data(const struct device *i2c_dev, void *ctx);
+void mlx90614_get_pec_stats(struct mlx90614_pec_stats *stats);
 
 #endif
\ No newline at end of file
@@ -2,8 +2,157 @@
 #include <zephyr/drivers/i2c.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/kernel.h>
-#include "mpu6050.h"
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include "MPU6050.h"
+#include "MPU6050_dmp.h"
 #include "i2c.h"
+#include "i2c_async.h"
+#include "i2c_plan.h"
+#include <string.h>
+
+// A gyro axis that moves more than this during calibration (+-250 deg/s LSBs, 5 deg/s) means the sensor was not still
+#define CALIB_MAX_GYRO_SPREAD 655
+#define CALIB_DEFAULT_SAMPLES 500
+#define CALIB_RATE_HZ         500
+
+static const struct device *mpu_i2c_dev;
+static uint16_t sample_rate_hz;
+static enum mpu6050_power_profile power_profile = MPU6050_POWER_SLEEP; // Reset state
+static uint8_t int_enable_bits; // Interrupts wanted outside wake-on-motion
+static mpu6050_data_cb_t data_cb;
+static uint8_t accel_fs = CONFIG_APP_MPU6050_ACCEL_FS;
+static uint8_t gyro_fs = CONFIG_APP_MPU6050_GYRO_FS;
+
+// Scale factors per full-scale range, indexed by AFS_SEL / FS_SEL
+static const float accel_g_per_lsb[] = {
+    1.0f / 16384.0f, // +-2 g
+    1.0f / 8192.0f,  // +-4 g
+    1.0f / 4096.0f,  // +-8 g
+    1.0f / 2048.0f,  // +-16 g
+};
+
+static const float gyro_dps_per_lsb[] = {
+    1.0f / 131.0f,   // +-250 deg/s
+    1.0f / 65.5f,    // +-500 deg/s
+    1.0f / 32.8f,    // +-1000 deg/s
+    1.0f / 16.4f,    // +-2000 deg/s
+};
+
+// FIFO mode state
+static bool fifo_enabled;
+static uint32_t fifo_overflows;
+static uint8_t fifo_buf[MPU6050_FIFO_SIZE];
+
+#ifdef CONFIG_APP_MPU6050_FIFO
+static struct mpu6050_sample fifo_samples[MPU6050_FIFO_MAX_SAMPLES];
+#endif
+
+// Registers of a polled sample. They are contiguous, so the plan comes out
+// as one 14-byte burst. Built on the first read. The lock covers the plan's
+// buffer, as the shell and the interrupt work queue read samples too.
+static struct i2c_read_plan sample_plan;
+static int accel_range, temp_range, gyro_range;
+static K_MUTEX_DEFINE(sample_plan_lock);
+
+#ifdef CONFIG_APP_MPU6050_DMP
+static struct mpu6050_dmp_packet dmp_packets[MPU6050_FIFO_SIZE / MPU6050_DMP_PACKET_SIZE];
+#endif
+
+static int16_t be16(const uint8_t *data) {
+    return (int16_t)((data[0] << 8) | data[1]); // Combine high and low byte
+}
+
+static void decode_channels(const uint8_t *accel, const uint8_t *temp, const uint8_t *gyro,
+                            struct mpu6050_sample *sample) {
+    for (int i = 0; i < 3; i++) {
+        sample->accel[i] = be16(&accel[2 * i]);
+        sample->gyro[i] = be16(&gyro[2 * i]);
+    }
+    sample->temp = be16(temp);
+    sample->accel_fs = accel_fs;
+    sample->gyro_fs = gyro_fs;
+}
+
+// Decode ACCEL_XOUT_H..GYRO_ZOUT_L as laid out in a FIFO frame
+static void decode_frame(const uint8_t *frame, struct mpu6050_sample *sample) {
+    decode_channels(&frame[0], &frame[6], &frame[8], sample);
+}
+
+void mpu6050_accel_to_g(const struct mpu6050_sample *sample, float accel_g[3]) {
+    float scale = accel_g_per_lsb[sample->accel_fs];
+
+    for (int i = 0; i < 3; i++) {
+        accel_g[i] = (float)sample->accel[i] * scale;
+    }
+}
+
+void mpu6050_gyro_to_dps(const struct mpu6050_sample *sample, float gyro_dps[3]) {
+    float scale = gyro_dps_per_lsb[sample->gyro_fs];
+
+    for (int i = 0; i < 3; i++) {
+        gyro_dps[i] = (float)sample->gyro[i] * scale;
+    }
+}
+
+void mpu6050_set_data_callback(mpu6050_data_cb_t cb) {
+    data_cb = cb;
+}
+
+static void print_sample(const struct mpu6050_sample *sample) {
+    // Print raw values for debugging
+    //printk("Raw Accelerometer (int16_t): X=%d, Y=%d, Z=%d\n", sample->accel[0], sample->accel[1], sample->accel[2]);
+    //printk("Raw Gyroscope (int16_t): X=%d, Y=%d, Z=%d\n", sample->gyro[0], sample->gyro[1], sample->gyro[2]);
+
+    float accel_g[3], gyro_dps[3];
+
+    mpu6050_accel_to_g(sample, accel_g);
+    printk("Accelerometer (g): X=%.4f, Y=%.4f, Z=%.4f\n", accel_g[0], accel_g[1], accel_g[2]);
+
+    mpu6050_gyro_to_dps(sample, gyro_dps);
+    printk("Gyroscope (°/s): X=%.4f, Y=%.4f, Z=%.4f\n", gyro_dps[0], gyro_dps[1], gyro_dps[2]);
+
+    float temp_float = (float)sample->temp / 340.0f + 36.53f; // Datasheet conversion
+    printk("MPU6050 die temperature: %.2f °C\n", temp_float);
+}
+
+#ifdef CONFIG_APP_MPU6050_CALIB_SETTINGS
+
+static struct mpu6050_offsets stored_offsets;
+static bool stored_offsets_valid;
+
+static int calib_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg) {
+    if (!settings_name_steq(name, "offsets", NULL)) {
+        return -ENOENT;
+    }
+    if (len != sizeof(stored_offsets)) {
+        return -EINVAL;
+    }
+
+    ssize_t rc = read_cb(cb_arg, &stored_offsets, sizeof(stored_offsets));
+    if (rc < 0) {
+        return rc;
+    }
+
+    stored_offsets_valid = true;
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(mpu6050, "mpu6050", NULL, calib_settings_set, NULL, NULL);
+
+// Write the offsets saved by the last calibration back to the chip
+static int calib_load(const struct device *i2c_dev) {
+    int ret = settings_subsys_init();
+    ret = ret ? ret : settings_load_subtree("mpu6050");
+    if (ret != 0) {
+        return ret;
+    }
+
+    return stored_offsets_valid ? mpu6050_set_offsets(i2c_dev, &stored_offsets) : -ENOENT;
+}
+
+#endif // CONFIG_APP_MPU6050_CALIB_SETTINGS
 
 void mpu6050_init(const struct device *i2c_dev) {
     uint8_t device_id;
@@ -17,54 +166,877 @@ void mpu6050_init(const struct device *i2c_dev) {
     printk("MPU6050 detected (device_id: 0x%02X)\n", device_id);
     k_msleep(100);
 
-    // Wake up MPU6050 by writing 0x00 to PWR_MGMT_1
-    if (i2c_write_register(i2c_dev, MPU6050_ADDR, PWR_MGMT_1, 0x00) != 0) {
+    // Wake up MPU6050 with accel and gyro running
+    if (mpu6050_set_power_profile(i2c_dev, MPU6050_POWER_FULL) != 0) {
         printk("Failed to wake up MPU6050\n");
+        return;
+    }
+
+    if (mpu6050_set_accel_range(i2c_dev, accel_fs) != 0 ||
+        mpu6050_set_gyro_range(i2c_dev, gyro_fs) != 0) {
+        printk("Failed to set MPU6050 full-scale ranges\n");
+        return;
+    }
+
+    mpu_i2c_dev = i2c_dev;
+
+#ifdef CONFIG_APP_MPU6050_CALIB_SETTINGS
+    // Offset registers come up with factory values after every power cycle
+    if (calib_load(i2c_dev) == 0) {
+        printk("MPU6050 offsets restored\n");
     } else {
-        printk("MPU6050 initialized successfully\n");
+        printk("MPU6050 not calibrated, run mpu6050_calibrate\n");
+    }
+#endif
+
+#ifdef CONFIG_APP_MPU6050_FIFO
+    if (mpu6050_fifo_enable(i2c_dev, CONFIG_APP_MPU6050_FIFO_RATE_HZ) != 0) {
+        printk("Failed to enable MPU6050 FIFO\n");
+        return;
+    }
+#endif
+
+#if !defined(CONFIG_APP_MPU6050_FIFO) && !defined(CONFIG_APP_MPU6050_INT) && !defined(CONFIG_APP_MPU6050_DMP)
+    // Polled once per acquisition tick, so sample no faster than that
+    if (mpu6050_set_sample_rate(i2c_dev, CLAMP(1000 / CONFIG_APP_ACQ_TICK_MS, 4, 1000)) < 0) {
+        printk("Failed to set MPU6050 sample rate\n");
+        return;
     }
+#endif
+
+#ifdef CONFIG_APP_MPU6050_DMP
+    if (mpu6050_dmp_init(i2c_dev) != 0) {
+        printk("Failed to start MPU6050 DMP\n");
+        return;
+    }
+#endif
+
+#ifdef CONFIG_APP_MPU6050_INT
+    if (mpu6050_int_start(i2c_dev) != 0) {
+        printk("Failed to set up MPU6050 interrupt\n");
+        return;
+    }
+#endif
+
+    printk("MPU6050 initialized successfully\n");
 }
 
-// Function to read and print MPU6050 data with string conversion for float
-void read_mpu6050_data(const struct device *i2c_dev) {
-    int16_t accel_x, accel_y, accel_z;
-    int16_t gyro_x, gyro_y, gyro_z;
-    uint8_t data[6];
+static int fifo_reset(const struct device *i2c_dev) {
+    // FIFO_RESET clears itself, so USER_CTRL is not shadowed
+    return i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL, USER_CTRL_FIFO_EN | USER_CTRL_FIFO_RESET);
+}
 
-    // Read accelerometer data (6 bytes)
-    if (i2c_read_registers(i2c_dev, MPU6050_ADDR, ACCEL_XOUT_H, data, 6) == 0) {
-        accel_x = (int16_t)((data[0] << 8) | data[1]); // Combine high and low byte
-        accel_y = (int16_t)((data[2] << 8) | data[3]);
-        accel_z = (int16_t)((data[4] << 8) | data[5]);
+#ifdef CONFIG_APP_MPU6050_AUTORANGE
 
-        // Print raw accelerometer values for debugging
-        //printk("Raw Accelerometer (int16_t): X=%d, Y=%d, Z=%d\n", accel_x, accel_y, accel_z);
+// Peak tracking for one sensor over the current auto-ranging window
+struct autorange {
+    uint16_t samples;
+    int peak;
+};
 
-        float accel_x_float = (float)accel_x / 16384.0f; // Convert to float
-        float accel_y_float = (float)accel_y / 16384.0f;
-        float accel_z_float = (float)accel_z / 16384.0f;
+static struct autorange accel_ar, gyro_ar;
 
-        printk("Accelerometer (g): X=%.4f, Y=%.4f, Z=%.4f\n", accel_x_float, accel_y_float, accel_z_float);
+static void autorange_reset(struct autorange *ar) {
+    ar->samples = 0;
+    ar->peak = 0;
+}
 
-    } else {
-        printk("Failed to read accelerometer data\n");
+// Returns 1 to step the range up, -1 to step it down, 0 to keep it
+static int autorange_feed(struct autorange *ar, const int16_t value[3]) {
+    for (int i = 0; i < 3; i++) {
+        int mag = abs(value[i]);
+
+        if (mag >= INT16_MAX) {
+            autorange_reset(ar);
+            return 1;
+        }
+        ar->peak = MAX(ar->peak, mag);
+    }
+
+    if (++ar->samples < CONFIG_APP_MPU6050_AUTORANGE_WINDOW) {
+        return 0;
+    }
+
+    int step = (ar->peak < INT16_MAX / 100 * CONFIG_APP_MPU6050_AUTORANGE_DOWN_PCT) ? -1 : 0;
+    autorange_reset(ar);
+    return step;
+}
+
+// Clipping wins over a pending step down
+static int autorange_merge(int step, int new_step) {
+    return (new_step > 0 || step == 0) ? new_step : step;
+}
+
+static void autorange_update(const struct device *i2c_dev, const struct mpu6050_sample *samples, size_t count) {
+    int accel_step = 0, gyro_step = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        // Samples from before the last switch say nothing about the current range
+        if (samples[i].accel_fs == accel_fs) {
+            accel_step = autorange_merge(accel_step, autorange_feed(&accel_ar, samples[i].accel));
+        }
+        if (samples[i].gyro_fs == gyro_fs) {
+            gyro_step = autorange_merge(gyro_step, autorange_feed(&gyro_ar, samples[i].gyro));
+        }
+    }
+
+    if ((accel_step > 0 && accel_fs < MPU6050_ACCEL_FS_16G) || (accel_step < 0 && accel_fs > MPU6050_ACCEL_FS_2G)) {
+        printk("MPU6050 accel range %s\n", accel_step > 0 ? "up" : "down");
+        mpu6050_set_accel_range(i2c_dev, accel_fs + accel_step);
+    }
+    if ((gyro_step > 0 && gyro_fs < MPU6050_GYRO_FS_2000DPS) || (gyro_step < 0 && gyro_fs > MPU6050_GYRO_FS_250DPS)) {
+        printk("MPU6050 gyro range %s\n", gyro_step > 0 ? "up" : "down");
+        mpu6050_set_gyro_range(i2c_dev, gyro_fs + gyro_step);
+    }
+}
+
+#else
+#define autorange_reset(ar)
+#define autorange_update(i2c_dev, samples, count)
+#endif // CONFIG_APP_MPU6050_AUTORANGE
+
+int mpu6050_set_accel_range(const struct device *i2c_dev, enum mpu6050_accel_fs fs) {
+    if (fs >= ARRAY_SIZE(accel_g_per_lsb)) {
+        return -EINVAL;
+    }
+
+    // ACCEL_CONFIG also holds the motion detector high-pass filter
+    int ret = i2c_update_register_bits(i2c_dev, MPU6050_ADDR, ACCEL_CONFIG, FS_SEL_MASK, fs << FS_SEL_SHIFT);
+    if (ret != 0) {
+        return ret;
+    }
+
+    accel_fs = fs;
+    autorange_reset(&accel_ar);
+    return fifo_enabled ? fifo_reset(i2c_dev) : 0;
+}
+
+int mpu6050_set_gyro_range(const struct device *i2c_dev, enum mpu6050_gyro_fs fs) {
+    if (fs >= ARRAY_SIZE(gyro_dps_per_lsb)) {
+        return -EINVAL;
     }
 
-    // Read gyroscope data (6 bytes)
-    if (i2c_read_registers(i2c_dev, MPU6050_ADDR, GYRO_XOUT_H, data, 6) == 0) {
-        gyro_x = (int16_t)((data[0] << 8) | data[1]);
-        gyro_y = (int16_t)((data[2] << 8) | data[3]);
-        gyro_z = (int16_t)((data[4] << 8) | data[5]);
+    int ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, GYRO_CONFIG, fs << FS_SEL_SHIFT);
+    if (ret != 0) {
+        return ret;
+    }
+
+    gyro_fs = fs;
+    autorange_reset(&gyro_ar);
+    return fifo_enabled ? fifo_reset(i2c_dev) : 0;
+}
+
+// Gyro bandwidth for each DLPF_CFG 1-6, accel is within a few Hz of it.
+// All of them run the sample clock at 1 kHz.
+static const uint16_t dlpf_bandwidth_hz[] = { 0, 188, 98, 42, 20, 10, 5 };
+
+// Widest filter that still cuts off below Nyquist, or the narrowest one
+static uint8_t dlpf_for_rate(uint16_t rate_hz) {
+    for (uint8_t cfg = 1; cfg < ARRAY_SIZE(dlpf_bandwidth_hz); cfg++) {
+        if (dlpf_bandwidth_hz[cfg] <= rate_hz / 2) {
+            return cfg;
+        }
+    }
+    return ARRAY_SIZE(dlpf_bandwidth_hz) - 1;
+}
+
+int mpu6050_set_sample_rate(const struct device *i2c_dev, uint16_t rate_hz) {
+    int ret;
+
+    if (rate_hz < 4 || rate_hz > 1000) {
+        return -EINVAL;
+    }
+
+    // Sample clock is 1 kHz with the DLPF on, divided by 1 + SMPLRT_DIV
+    uint8_t div = (1000 + rate_hz / 2) / rate_hz - 1;
+    ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, MPU_CONFIG, dlpf_for_rate(rate_hz));
+    ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, SMPLRT_DIV, div);
+    if (ret != 0) {
+        return ret;
+    }
+
+    sample_rate_hz = 1000 / (div + 1);
+
+    // Samples already queued were taken at the old rate and would get wrong timestamps
+    if (fifo_enabled) {
+        ret = fifo_reset(i2c_dev);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return sample_rate_hz;
+}
+
+uint16_t mpu6050_get_sample_rate(void) {
+    return sample_rate_hz;
+}
+
+enum mpu6050_power_profile mpu6050_get_power_profile(void) {
+    return power_profile;
+}
+
+int mpu6050_set_power_profile(const struct device *i2c_dev, enum mpu6050_power_profile profile) {
+    uint8_t pwr_mgmt_1, pwr_mgmt_2 = 0;
+    int ret = 0;
+
+    if ((fifo_enabled || mpu6050_dmp_enabled()) && profile != MPU6050_POWER_FULL && profile != MPU6050_POWER_SLEEP) {
+        return -EBUSY;
+    }
+    // Motion is only reported through the INT pin, without it the sensor would never wake
+    if (!IS_ENABLED(CONFIG_APP_MPU6050_INT) && profile == MPU6050_POWER_WAKE_ON_MOTION) {
+        return -ENOTSUP;
+    }
 
-        // Print raw gyroscope values for debugging
-        //printk("Raw Gyroscope (int16_t): X=%d, Y=%d, Z=%d\n", gyro_x, gyro_y, gyro_z);
-        float gyro_x_float = (float)gyro_x / 131.0f; // Convert to float
-        float gyro_y_float = (float)gyro_y / 131.0f;
-        float gyro_z_float = (float)gyro_z / 131.0f;
+    switch (profile) {
+    case MPU6050_POWER_FULL:
+        pwr_mgmt_1 = PWR_MGMT_1_CLK_PLL_XGYRO;
+        break;
+    case MPU6050_POWER_ACCEL_ONLY:
+        // The gyro PLL stops in standby, run from the internal oscillator
+        pwr_mgmt_1 = 0x00;
+        pwr_mgmt_2 = PWR_MGMT_2_STBY_GYRO;
+        break;
+    case MPU6050_POWER_ACCEL_CYCLE:
+    case MPU6050_POWER_WAKE_ON_MOTION:
+        pwr_mgmt_1 = PWR_MGMT_1_CYCLE | PWR_MGMT_1_TEMP_DIS;
+        pwr_mgmt_2 = (CONFIG_APP_MPU6050_LP_WAKE_CTRL << LP_WAKE_CTRL_SHIFT) | PWR_MGMT_2_STBY_GYRO;
+        break;
+    case MPU6050_POWER_SLEEP:
+        pwr_mgmt_1 = PWR_MGMT_1_SLEEP;
+        break;
+    default:
+        return -EINVAL;
+    }
 
-        printk("Gyroscope (°/s): X=%.4f, Y=%.4f, Z=%.4f\n", gyro_x_float, gyro_y_float, gyro_z_float);
+    if (profile == MPU6050_POWER_WAKE_ON_MOTION) {
+        ret = i2c_update_register_bits(i2c_dev, MPU6050_ADDR, ACCEL_CONFIG, ACCEL_HPF_MASK, ACCEL_HPF_5HZ);
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, MOT_THR,
+                                                    CONFIG_APP_MPU6050_MOTION_THRESHOLD_MG / 2);
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, MOT_DUR,
+                                                    CONFIG_APP_MPU6050_MOTION_DURATION_MS);
+    }
+    if (profile == MPU6050_POWER_WAKE_ON_MOTION || power_profile == MPU6050_POWER_WAKE_ON_MOTION) {
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, INT_ENABLE,
+                                                    profile == MPU6050_POWER_WAKE_ON_MOTION ? INT_ENABLE_MOT
+                                                                                            : int_enable_bits);
+    }
+    if (ret != 0) {
+        return ret;
+    }
 
+    // Bring the gyro up before selecting its PLL, and leave the PLL before
+    // putting the gyro into standby
+    if (profile == MPU6050_POWER_FULL) {
+        ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, PWR_MGMT_2, pwr_mgmt_2);
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, PWR_MGMT_1, pwr_mgmt_1);
     } else {
-        printk("Failed to read gyroscope data\n");
+        ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, PWR_MGMT_1, pwr_mgmt_1);
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, PWR_MGMT_2, pwr_mgmt_2);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    power_profile = profile;
+    return 0;
+}
+
+int mpu6050_fifo_enable(const struct device *i2c_dev, uint16_t rate_hz) {
+    int ret = mpu6050_set_sample_rate(i2c_dev, rate_hz);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, FIFO_EN, FIFO_EN_ACCEL_TEMP_GYRO);
+    ret = ret ? ret : fifo_reset(i2c_dev);
+    if (ret != 0) {
+        return ret;
+    }
+
+    fifo_enabled = true;
+    return 0;
+}
+
+int mpu6050_fifo_disable(const struct device *i2c_dev) {
+    fifo_enabled = false;
+
+    int ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, FIFO_EN, 0x00);
+    return ret ? ret : i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL, USER_CTRL_FIFO_RESET);
+}
+
+#ifdef CONFIG_APP_I2C_ASYNC
+
+// Read n frames of FIFO_R_W into fifo_buf and decode them into samples. The
+// chunks go through the async queue, and the frames already in are decoded
+// while the next chunk is on the bus.
+static int fifo_drain(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t n) {
+    size_t len = n * MPU6050_FIFO_SAMPLE_SIZE;
+    size_t received = 0, decoded = 0;
+    struct i2c_async_txn txn;
+
+    while (received < len) {
+        size_t chunk = MIN(len - received, I2C_MAX_READ_LEN);
+
+        i2c_async_read_init(&txn, i2c_dev, MPU6050_ADDR, FIFO_R_W, &fifo_buf[received], chunk, NULL, NULL);
+        int ret = i2c_async_submit(&txn);
+        if (ret != 0) {
+            return ret;
+        }
+
+        for (; decoded < received / MPU6050_FIFO_SAMPLE_SIZE; decoded++) {
+            decode_frame(&fifo_buf[decoded * MPU6050_FIFO_SAMPLE_SIZE], &samples[decoded]);
+        }
+
+        ret = i2c_async_wait(&txn, K_FOREVER);
+        if (ret != 0) {
+            return ret;
+        }
+        received += chunk;
+    }
+
+    for (; decoded < n; decoded++) {
+        decode_frame(&fifo_buf[decoded * MPU6050_FIFO_SAMPLE_SIZE], &samples[decoded]);
+    }
+    return 0;
+}
+
+#else
+
+static int fifo_drain(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t n) {
+    // In I2C_MAX_READ_LEN chunks, a whole drain would outlast the bus driver's timeout
+    int ret = i2c_read_fifo(i2c_dev, MPU6050_ADDR, FIFO_R_W, fifo_buf, n * MPU6050_FIFO_SAMPLE_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        decode_frame(&fifo_buf[i * MPU6050_FIFO_SAMPLE_SIZE], &samples[i]);
+    }
+    return 0;
+}
+
+#endif // CONFIG_APP_I2C_ASYNC
+
+int mpu6050_fifo_read(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t max) {
+    uint8_t int_status, count_buf[2];
+    struct i2c_reg_block status_blocks[] = {
+        { INT_STATUS, &int_status, 1 },  // Reading clears the overflow flag
+        { FIFO_COUNTH, count_buf, 2 },
+    };
+    int ret;
+
+    if (!fifo_enabled) {
+        return -EINVAL;
+    }
+
+    ret = i2c_read_register_blocks(i2c_dev, MPU6050_ADDR, status_blocks, ARRAY_SIZE(status_blocks));
+    if (ret != 0) {
+        return ret;
+    }
+
+    int64_t now_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    uint16_t count = (count_buf[0] << 8) | count_buf[1];
+
+    // After an overflow the oldest bytes are gone and the frame boundary is lost
+    if (int_status & INT_STATUS_FIFO_OFLOW) {
+        fifo_overflows++;
+        fifo_reset(i2c_dev);
+        return -EOVERFLOW;
+    }
+
+    // A count that is not a whole number of frames was read while the sensor
+    // was writing one. That frame is left for the next read.
+    size_t available = count / MPU6050_FIFO_SAMPLE_SIZE;
+    size_t n = MIN(available, max);
+    if (n == 0) {
+        return 0;
+    }
+
+    ret = fifo_drain(i2c_dev, samples, n);
+    if (ret != 0) {
+        // Some chunks may have been taken out, so the frame boundary is lost too
+        fifo_reset(i2c_dev);
+        return ret;
+    }
+
+    // The newest sample in the FIFO was taken about now, the rest one period apart
+    int64_t period_us = 1000000 / sample_rate_hz;
+    for (size_t i = 0; i < n; i++) {
+        samples[i].timestamp_us = now_us - (int64_t)(available - 1 - i) * period_us;
+    }
+
+    autorange_update(i2c_dev, samples, n);
+    return n;
+}
+
+static int sample_plan_build(const struct device *i2c_dev) {
+    i2c_plan_init(&sample_plan, i2c_dev, MPU6050_ADDR);
+    accel_range = i2c_plan_add(&sample_plan, ACCEL_XOUT_H, 6);
+    temp_range = i2c_plan_add(&sample_plan, TEMP_OUT_H, 2);
+    gyro_range = i2c_plan_add(&sample_plan, GYRO_XOUT_H, 6);
+
+    int ret = i2c_plan_build(&sample_plan);
+    if (ret != 0) {
+        sample_plan.i2c_dev = NULL; // Try again on the next read
+    }
+    return ret;
+}
+
+int mpu6050_read_sample(const struct device *i2c_dev, struct mpu6050_sample *sample) {
+    int ret = 0;
+
+    k_mutex_lock(&sample_plan_lock, K_FOREVER);
+    if (sample_plan.i2c_dev != i2c_dev) {
+        ret = sample_plan_build(i2c_dev);
+    }
+    ret = ret ? ret : i2c_plan_execute(&sample_plan);
+    if (ret == 0) {
+        sample->timestamp_us = k_ticks_to_us_floor64(k_uptime_ticks());
+        decode_channels(i2c_plan_slice(&sample_plan, accel_range), i2c_plan_slice(&sample_plan, temp_range),
+                        i2c_plan_slice(&sample_plan, gyro_range), sample);
+    }
+    k_mutex_unlock(&sample_plan_lock);
+    if (ret != 0) {
+        return ret;
+    }
+
+    autorange_update(i2c_dev, sample, 1);
+    return 0;
+}
+
+int mpu6050_get_offsets(const struct device *i2c_dev, struct mpu6050_offsets *offsets) {
+    uint8_t accel[6], gyro[6];
+
+    int ret = i2c_read_registers(i2c_dev, MPU6050_ADDR, XA_OFFS_H, accel, sizeof(accel));
+    ret = ret ? ret : i2c_read_registers(i2c_dev, MPU6050_ADDR, XG_OFFS_USRH, gyro, sizeof(gyro));
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        offsets->accel[i] = be16(&accel[2 * i]);
+        offsets->gyro[i] = be16(&gyro[2 * i]);
+    }
+    return 0;
+}
+
+int mpu6050_set_offsets(const struct device *i2c_dev, const struct mpu6050_offsets *offsets) {
+    uint8_t accel[6], gyro[6];
+
+    for (int i = 0; i < 3; i++) {
+        accel[2 * i] = (uint16_t)offsets->accel[i] >> 8;
+        accel[2 * i + 1] = offsets->accel[i] & 0xFF;
+        gyro[2 * i] = (uint16_t)offsets->gyro[i] >> 8;
+        gyro[2 * i + 1] = offsets->gyro[i] & 0xFF;
+    }
+
+    // Not shadowed, the offsets would take up most of the device's shadow slots
+    int ret = i2c_write_registers(i2c_dev, MPU6050_ADDR, XA_OFFS_H, accel, sizeof(accel));
+    ret = ret ? ret : i2c_write_registers(i2c_dev, MPU6050_ADDR, XG_OFFS_USRH, gyro, sizeof(gyro));
+    return ret;
+}
+
+// Sum num_samples in +-2 g and +-250 deg/s LSBs, so auto-ranging may switch
+// meanwhile. Returns -EAGAIN if a gyro axis moved.
+static int calib_measure(const struct device *i2c_dev, uint16_t num_samples, int32_t accel_sum[3],
+                         int32_t gyro_sum[3]) {
+    struct mpu6050_sample sample;
+    int32_t gyro_min[3] = {INT32_MAX, INT32_MAX, INT32_MAX}, gyro_max[3] = {INT32_MIN, INT32_MIN, INT32_MIN};
+
+    for (uint16_t n = 0; n < num_samples; n++) {
+        int ret = mpu6050_read_sample(i2c_dev, &sample);
+        if (ret != 0) {
+            return ret;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            int32_t gyro = sample.gyro[i] * (1 << sample.gyro_fs);
+
+            accel_sum[i] += sample.accel[i] * (1 << sample.accel_fs);
+            gyro_sum[i] += gyro;
+            gyro_min[i] = MIN(gyro_min[i], gyro);
+            gyro_max[i] = MAX(gyro_max[i], gyro);
+        }
+        // One read per sample period, so every read is a new sample
+        k_usleep(USEC_PER_SEC / sample_rate_hz);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (gyro_max[i] - gyro_min[i] > CALIB_MAX_GYRO_SPREAD) {
+            return -EAGAIN;
+        }
+    }
+    return 0;
+}
+
+int mpu6050_calibrate(const struct device *i2c_dev, uint16_t num_samples) {
+    struct mpu6050_offsets offsets;
+    int32_t accel_sum[3] = {0}, gyro_sum[3] = {0};
+    uint16_t rate_hz = sample_rate_hz;
+    int ret;
+
+    if (num_samples == 0 || num_samples > 2000) {
+        return -EINVAL;
+    }
+    if (power_profile != MPU6050_POWER_FULL) {
+        return -EBUSY;
+    }
+
+    // The current offsets are already applied, so only the residual bias is measured
+    ret = mpu6050_get_offsets(i2c_dev, &offsets);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Polled, the rate follows the acquisition tick down to 4 Hz behind a 5 Hz
+    // filter, and the window would hold a handful of smoothed samples. Sample
+    // fast while measuring and put the rate back after.
+    ret = mpu6050_set_sample_rate(i2c_dev, CALIB_RATE_HZ);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = calib_measure(i2c_dev, num_samples, accel_sum, gyro_sum);
+    if (rate_hz != 0) {
+        int restored = mpu6050_set_sample_rate(i2c_dev, rate_hz);
+
+        ret = ret ? ret : MIN(restored, 0);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    // At rest with +Z up the accelerometer should read 1 g on Z and 0 elsewhere
+    accel_sum[2] -= 16384 * num_samples;
+
+    // Offset registers count 8x and 4x coarser LSBs than the sums. Accel
+    // bit 0 is reserved, so the accel correction is kept even.
+    for (int i = 0; i < 3; i++) {
+        offsets.accel[i] -= DIV_ROUND_CLOSEST(accel_sum[i], 8 * num_samples) & ~1;
+        offsets.gyro[i] -= DIV_ROUND_CLOSEST(gyro_sum[i], 4 * num_samples);
+    }
+
+    ret = mpu6050_set_offsets(i2c_dev, &offsets);
+    if (ret != 0) {
+        return ret;
+    }
+
+#ifdef CONFIG_APP_MPU6050_CALIB_SETTINGS
+    ret = settings_save_one("mpu6050/offsets", &offsets, sizeof(offsets));
+#endif
+    return ret;
+}
+
+#ifdef CONFIG_SHELL
+
+static int cmd_mpu6050_calibrate(const struct shell *sh, size_t argc, char **argv) {
+    uint16_t num_samples = (argc > 1) ? strtoul(argv[1], NULL, 0) : CALIB_DEFAULT_SAMPLES;
+    struct mpu6050_offsets offsets;
+
+    if (mpu_i2c_dev == NULL) {
+        shell_error(sh, "MPU6050 not initialized");
+        return -ENODEV;
+    }
+
+    shell_print(sh, "Keep the sensor still, +Z up...");
+    int ret = mpu6050_calibrate(mpu_i2c_dev, num_samples);
+    if (ret == -EAGAIN) {
+        shell_error(sh, "Sensor moved during calibration, try again");
+        return ret;
+    } else if (ret != 0) {
+        shell_error(sh, "Calibration failed (%d)", ret);
+        return ret;
+    }
+
+    mpu6050_get_offsets(mpu_i2c_dev, &offsets);
+    shell_print(sh, "Accel offsets: %d %d %d", offsets.accel[0], offsets.accel[1], offsets.accel[2]);
+    shell_print(sh, "Gyro offsets:  %d %d %d", offsets.gyro[0], offsets.gyro[1], offsets.gyro[2]);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(mpu6050_calibrate, NULL, "Calibrate MPU6050 bias [samples]", cmd_mpu6050_calibrate, 1, 1);
+
+static int cmd_mpu6050_rate(const struct shell *sh, size_t argc, char **argv) {
+    if (argc > 1) {
+        if (mpu_i2c_dev == NULL) {
+            shell_error(sh, "MPU6050 not initialized");
+            return -ENODEV;
+        }
+
+        int ret = mpu6050_set_sample_rate(mpu_i2c_dev, strtoul(argv[1], NULL, 0));
+        if (ret < 0) {
+            shell_error(sh, "Failed to set sample rate (%d)", ret);
+            return ret;
+        }
+    }
+
+    shell_print(sh, "MPU6050 sample rate: %u Hz", sample_rate_hz);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(mpu6050_rate, NULL, "Show or set MPU6050 sample rate, DLPF follows [4-1000 Hz]",
+                       cmd_mpu6050_rate, 1, 1);
+
+static const char *const power_profile_names[] = {
+    [MPU6050_POWER_FULL] = "full",
+    [MPU6050_POWER_ACCEL_ONLY] = "accel",
+    [MPU6050_POWER_ACCEL_CYCLE] = "cycle",
+    [MPU6050_POWER_WAKE_ON_MOTION] = "wom",
+    [MPU6050_POWER_SLEEP] = "sleep",
+};
+
+static int cmd_mpu6050_power(const struct shell *sh, size_t argc, char **argv) {
+    if (argc < 2) {
+        shell_print(sh, "MPU6050 power profile: %s", power_profile_names[power_profile]);
+        return 0;
+    }
+    if (mpu_i2c_dev == NULL) {
+        shell_error(sh, "MPU6050 not initialized");
+        return -ENODEV;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(power_profile_names); i++) {
+        if (strcmp(argv[1], power_profile_names[i]) == 0) {
+            int ret = mpu6050_set_power_profile(mpu_i2c_dev, i);
+            if (ret != 0) {
+                shell_error(sh, "Failed to set power profile (%d)", ret);
+            }
+            return ret;
+        }
+    }
+
+    shell_error(sh, "Unknown profile, use full, accel, cycle, wom or sleep");
+    return -EINVAL;
+}
+
+SHELL_CMD_ARG_REGISTER(mpu6050_power, NULL, "Show or set MPU6050 power profile [full|accel|cycle|wom|sleep]",
+                       cmd_mpu6050_power, 1, 1);
+
+#endif
+
+#ifdef CONFIG_APP_MPU6050_INT
+
+#define ZEPHYR_USER_NODE DT_PATH(zephyr_user)
+
+BUILD_ASSERT(DT_NODE_HAS_PROP(ZEPHYR_USER_NODE, mpu6050_int_gpios),
+             "CONFIG_APP_MPU6050_INT needs mpu6050-int-gpios in the zephyr,user node");
+
+static const struct gpio_dt_spec int_gpio = GPIO_DT_SPEC_GET(ZEPHYR_USER_NODE, mpu6050_int_gpios);
+static struct gpio_callback int_gpio_cb;
+static const struct device *int_i2c_dev;
+static atomic_t int_pending; // INT pulses since the work handler last ran
+static uint32_t data_ready_count; // FIFO mode: data-ready pulses since the last drain
+
+K_THREAD_STACK_DEFINE(int_stack, CONFIG_APP_MPU6050_INT_STACK_SIZE);
+static struct k_work_q int_workq;
+static struct k_work int_work;
+
+// Newest sample read by the interrupt path, picked up by read_mpu6050_data()
+static struct k_spinlock latest_lock;
+static struct mpu6050_sample latest_sample;
+static uint32_t samples_since_print;
+static mpu6050_motion_cb_t motion_cb;
+
+void mpu6050_set_motion_callback(mpu6050_motion_cb_t cb) {
+    motion_cb = cb;
+}
+
+static void publish(const struct mpu6050_sample *samples, size_t count) {
+    k_spinlock_key_t key = k_spin_lock(&latest_lock);
+    latest_sample = samples[count - 1];
+    samples_since_print += count;
+    k_spin_unlock(&latest_lock, key);
+
+    if (data_cb != NULL) {
+        data_cb(samples, count);
+    }
+}
+
+static void int_work_handler(struct k_work *work) {
+    atomic_val_t pulses = atomic_clear(&int_pending);
+
+    // Only the motion interrupt is enabled, there is no sample to read
+    if (power_profile == MPU6050_POWER_WAKE_ON_MOTION) {
+        uint8_t int_status;
+        if (i2c_read_register(int_i2c_dev, MPU6050_ADDR, INT_STATUS, &int_status) == 0 &&
+            (int_status & INT_STATUS_MOT) && motion_cb != NULL) {
+            motion_cb();
+        }
+        return;
+    }
+
+#ifdef CONFIG_APP_MPU6050_FIFO
+    // The MPU6050 has no FIFO watermark interrupt, so data-ready pulses are
+    // counted instead. FIFO overflow pulses the same pin, and INT_STATUS
+    // tells them apart. Reading it clears the overflow flag, so the reset
+    // mpu6050_fifo_read() would do happens here.
+    uint8_t int_status;
+    if (i2c_read_register(int_i2c_dev, MPU6050_ADDR, INT_STATUS, &int_status) != 0) {
+        return;
+    }
+    if (int_status & INT_STATUS_FIFO_OFLOW) {
+        fifo_overflows++;
+        fifo_reset(int_i2c_dev);
+        data_ready_count = 0;
+        return;
+    }
+    if (int_status & INT_STATUS_DATA_RDY) {
+        data_ready_count += pulses;
+    }
+    if (data_ready_count < CONFIG_APP_MPU6050_FIFO_WATERMARK) {
+        return;
+    }
+    data_ready_count = 0;
+
+    int n = mpu6050_fifo_read(int_i2c_dev, fifo_samples, ARRAY_SIZE(fifo_samples));
+    if (n > 0) {
+        publish(fifo_samples, n);
+    }
+#else
+    // Only data-ready is enabled, one sample per run however many pulses it covers
+    ARG_UNUSED(pulses);
+
+    struct mpu6050_sample sample;
+    if (mpu6050_read_sample(int_i2c_dev, &sample) == 0) {
+        publish(&sample, 1);
+    }
+#endif
+}
+
+static void int_gpio_handler(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins) {
+    // Which interrupt it was takes a bus read, so that is left to the work queue
+    atomic_inc(&int_pending);
+    k_work_submit_to_queue(&int_workq, &int_work);
+}
+
+int mpu6050_int_start(const struct device *i2c_dev) {
+    int ret;
+
+    if (!gpio_is_ready_dt(&int_gpio)) {
+        return -ENODEV;
     }
-}
\ No newline at end of file
+
+    int_i2c_dev = i2c_dev;
+    k_work_init(&int_work, int_work_handler);
+    k_work_queue_start(&int_workq, int_stack, K_THREAD_STACK_SIZEOF(int_stack),
+                       CONFIG_APP_MPU6050_INT_PRIORITY, NULL);
+
+    if (!fifo_enabled) {
+        ret = mpu6050_set_sample_rate(i2c_dev, CONFIG_APP_MPU6050_INT_RATE_HZ);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    // Active high, push-pull, 50 us pulse per event so every sample gives an edge
+    int_enable_bits = INT_ENABLE_DATA_RDY | (fifo_enabled ? INT_ENABLE_FIFO_OFLOW : 0);
+    ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, INT_PIN_CFG, 0x00);
+    if (power_profile != MPU6050_POWER_WAKE_ON_MOTION) {
+        ret = ret ? ret : i2c_write_register_cached(i2c_dev, MPU6050_ADDR, INT_ENABLE, int_enable_bits);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = gpio_pin_configure_dt(&int_gpio, GPIO_INPUT);
+    ret = ret ? ret : gpio_pin_interrupt_configure_dt(&int_gpio, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    gpio_init_callback(&int_gpio_cb, int_gpio_handler, BIT(int_gpio.pin));
+    return gpio_add_callback(int_gpio.port, &int_gpio_cb);
+}
+
+#endif // CONFIG_APP_MPU6050_INT
+
+// Function to read and print MPU6050 data with string conversion for float
+void read_mpu6050_data(const struct device *i2c_dev, void *ctx) {
+#if defined(CONFIG_APP_MPU6050_INT)
+    // Samples arrive on the interrupt path, just report the newest one
+    k_spinlock_key_t key = k_spin_lock(&latest_lock);
+    struct mpu6050_sample sample = latest_sample;
+    uint32_t count = samples_since_print;
+    samples_since_print = 0;
+    k_spin_unlock(&latest_lock, key);
+
+    printk("MPU6050: %u samples since last tick\n", count);
+    if (count > 0) {
+        print_sample(&sample);
+    }
+#elif defined(CONFIG_APP_MPU6050_DMP)
+    // Drain the DMP packets, report the newest orientation and any gestures
+    int n = mpu6050_dmp_read(i2c_dev, dmp_packets, ARRAY_SIZE(dmp_packets));
+    if (n == -EOVERFLOW) {
+        printk("MPU6050 DMP FIFO overflow, reset\n");
+        return;
+    } else if (n < 0) {
+        printk("Failed to read MPU6050 DMP packets\n");
+        return;
+    }
+
+    printk("MPU6050 DMP: %d packets\n", n);
+    for (int i = 0; i < n; i++) {
+        if (dmp_packets[i].tap_count > 0) {
+            printk("Tap: direction %u, count %u\n", dmp_packets[i].tap_dir, dmp_packets[i].tap_count);
+        }
+        if (dmp_packets[i].orientation != MPU6050_ORIENT_NONE) {
+            printk("Orientation: %u\n", dmp_packets[i].orientation);
+        }
+    }
+    if (n > 0) {
+        const int32_t *q = dmp_packets[n - 1].quat;
+        printk("Quaternion: w=%.4f, x=%.4f, y=%.4f, z=%.4f\n", q[0] / 1073741824.0f, q[1] / 1073741824.0f,
+               q[2] / 1073741824.0f, q[3] / 1073741824.0f);
+    }
+#elif defined(CONFIG_APP_MPU6050_FIFO)
+    // Drain everything sampled since the last call and print the newest sample
+    int n = mpu6050_capture(i2c_dev, fifo_samples, ARRAY_SIZE(fifo_samples));
+    if (n == -EOVERFLOW) {
+        printk("MPU6050 FIFO overflow, reset (%u so far)\n", fifo_overflows);
+        return;
+    } else if (n < 0) {
+        printk("Failed to read MPU6050 FIFO\n");
+        return;
+    }
+
+    printk("MPU6050 FIFO: %d samples\n", n);
+    if (n > 0) {
+        print_sample(&fifo_samples[n - 1]);
+        if (data_cb != NULL) {
+            data_cb(fifo_samples, n);
+        }
+    }
+#else
+    struct mpu6050_sample sample;
+
+    if (mpu6050_capture(i2c_dev, &sample, 1) < 0) {
+        printk("Failed to read accelerometer/temperature/gyroscope data\n");
+        return;
+    }
+
+    print_sample(&sample);
+    if (data_cb != NULL) {
+        data_cb(&sample, 1);
+    }
+#endif
+}
+
+#if !defined(CONFIG_APP_MPU6050_INT) && !defined(CONFIG_APP_MPU6050_DMP)
+
+int mpu6050_capture(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t max) {
+    int n;
+
+    if (max == 0) {
+        return -ENOMEM;
+    }
+
+#ifdef CONFIG_APP_MPU6050_FIFO
+    n = mpu6050_fifo_read(i2c_dev, samples, max);
+#else
+    n = mpu6050_read_sample(i2c_dev, &samples[0]);
+    n = (n == 0) ? 1 : n;
+#endif
+    return n;
+}
+
+#endif
\ No newline at end of file
@@ -12,11 +12,161 @@
 // MPU6050 Registers
 #define MPU6050_ADDR 0x68          // Default I2C address of MPU6050
 #define DEVICE_ID 0x75
+#define XA_OFFS_H    0x06          // Accel offsets XA/YA/ZA, +-16 g LSBs, bit 0 reserved
+#define XG_OFFS_USRH 0x13          // Gyro offsets XG/YG/ZG, +-1000 deg/s LSBs
 #define PWR_MGMT_1   0x6B
 #define ACCEL_XOUT_H 0x3B
+#define TEMP_OUT_H   0x41
 #define GYRO_XOUT_H  0x43
+#define SMPLRT_DIV   0x19
+#define MPU_CONFIG   0x1A          // CONFIG register, holds DLPF_CFG
+#define GYRO_CONFIG  0x1B
+#define ACCEL_CONFIG 0x1C
+#define MOT_THR      0x1F          // Motion threshold, 2 mg per LSB
+#define MOT_DUR      0x20          // Motion duration, 1 ms per LSB
+#define FIFO_EN      0x23
+#define INT_PIN_CFG  0x37
+#define INT_ENABLE   0x38
+#define INT_STATUS   0x3A
+#define USER_CTRL    0x6A
+#define PWR_MGMT_2   0x6C
+#define FIFO_COUNTH  0x72
+#define FIFO_R_W     0x74
+
+// Register bits
+#define FIFO_EN_ACCEL_TEMP_GYRO 0xF8  // TEMP, XG, YG, ZG and ACCEL into the FIFO
+#define USER_CTRL_FIFO_EN    0x40
+#define USER_CTRL_FIFO_RESET 0x04
+#define INT_STATUS_FIFO_OFLOW 0x10
+#define INT_STATUS_DATA_RDY   0x01
+#define INT_ENABLE_DATA_RDY  0x01
+#define INT_ENABLE_FIFO_OFLOW 0x10
+#define INT_ENABLE_MOT       0x40
+#define INT_STATUS_MOT       0x40
+#define FS_SEL_SHIFT         3     // FS_SEL / AFS_SEL in GYRO_CONFIG / ACCEL_CONFIG
+#define FS_SEL_MASK          0x18
+#define ACCEL_HPF_MASK       0x07  // Motion detector high-pass filter in ACCEL_CONFIG
+#define ACCEL_HPF_5HZ        0x01
+#define PWR_MGMT_1_SLEEP     0x40
+#define PWR_MGMT_1_CYCLE     0x20
+#define PWR_MGMT_1_TEMP_DIS  0x08
+#define PWR_MGMT_1_CLK_PLL_XGYRO 0x01
+#define PWR_MGMT_2_STBY_GYRO 0x07  // STBY_XG, STBY_YG, STBY_ZG
+#define LP_WAKE_CTRL_SHIFT   6
+
+// Power profiles, from most to least current drawn
+enum mpu6050_power_profile {
+    MPU6050_POWER_FULL,          // Accel and gyro running, gyro PLL as clock
+    MPU6050_POWER_ACCEL_ONLY,    // Gyro in standby, accel sampled as usual
+    MPU6050_POWER_ACCEL_CYCLE,   // Accel woken at the LP_WAKE_CTRL rate, sleeping in between
+    MPU6050_POWER_WAKE_ON_MOTION,// Accel cycle mode, INT only fires on motion
+    MPU6050_POWER_SLEEP,
+};
+
+// Full-scale ranges, values are the FS_SEL / AFS_SEL field
+enum mpu6050_accel_fs {
+    MPU6050_ACCEL_FS_2G,
+    MPU6050_ACCEL_FS_4G,
+    MPU6050_ACCEL_FS_8G,
+    MPU6050_ACCEL_FS_16G,
+};
+
+enum mpu6050_gyro_fs {
+    MPU6050_GYRO_FS_250DPS,
+    MPU6050_GYRO_FS_500DPS,
+    MPU6050_GYRO_FS_1000DPS,
+    MPU6050_GYRO_FS_2000DPS,
+};
+
+// Accel XYZ, temperature, gyro XYZ, big endian. Same layout for a burst
+// read from ACCEL_XOUT_H and for a FIFO frame.
+#define MPU6050_SAMPLE_SIZE      14
+
+#define MPU6050_FIFO_SIZE        1024
+#define MPU6050_FIFO_SAMPLE_SIZE MPU6050_SAMPLE_SIZE
+#define MPU6050_FIFO_MAX_SAMPLES (MPU6050_FIFO_SIZE / MPU6050_FIFO_SAMPLE_SIZE)
+
+struct mpu6050_sample {
+    int64_t timestamp_us;  // System uptime when the sample was taken
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temp;          // Die temperature, degrees C = temp / 340 + 36.53
+    uint8_t accel_fs;      // enum mpu6050_accel_fs the sample was taken with
+    uint8_t gyro_fs;       // enum mpu6050_gyro_fs the sample was taken with
+};
+
+// Contents of the offset registers, added by the chip to every sample
+struct mpu6050_offsets {
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+typedef void (*mpu6050_data_cb_t)(const struct mpu6050_sample *samples, size_t count);
+typedef void (*mpu6050_motion_cb_t)(void);
 
 void mpu6050_init(const struct device *i2c_dev);
-void read_mpu6050_data(const struct device *i2c_dev);
+// Acquisition reader, ctx is unused as there is only one MPU6050
+void read_mpu6050_data(const struct device *i2c_dev, void *ctx);
+int mpu6050_read_sample(const struct device *i2c_dev, struct mpu6050_sample *sample);
+// Raw samples for one acquisition tick: the FIFO drained with CONFIG_APP_MPU6050_FIFO,
+// otherwise one register read. The data callback is left to the caller, so a
+// sensor driver submit stays a plain read. Returns the number stored, or an
+// error as mpu6050_fifo_read(). Not available with CONFIG_APP_MPU6050_INT or
+// CONFIG_APP_MPU6050_DMP, which own the data path.
+int mpu6050_capture(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t max);
+
+// Full-scale range selection. The initial ranges come from Kconfig. In FIFO
+// mode the FIFO is reset so no sample is decoded with the wrong range.
+int mpu6050_set_accel_range(const struct device *i2c_dev, enum mpu6050_accel_fs fs);
+int mpu6050_set_gyro_range(const struct device *i2c_dev, enum mpu6050_gyro_fs fs);
+
+// Conversion to g and deg/s using the range stored in the sample
+void mpu6050_accel_to_g(const struct mpu6050_sample *sample, float accel_g[3]);
+void mpu6050_gyro_to_dps(const struct mpu6050_sample *sample, float gyro_dps[3]);
+
+// Called with every batch of samples read: on the interrupt work queue with
+// CONFIG_APP_MPU6050_INT, otherwise from read_mpu6050_data(). The sensor
+// driver has its own, sensor_readout_set_mpu6050_callback().
+void mpu6050_set_data_callback(mpu6050_data_cb_t cb);
+
+// Bias calibration. The sensor must lie still with +Z up while num_samples
+// samples are averaged, taken at 500 Hz whatever the configured rate, which
+// is restored afterwards. The result goes into the offset registers, so it
+// costs nothing per sample, and with CONFIG_APP_MPU6050_CALIB_SETTINGS it is
+// saved and restored by mpu6050_init(). Returns -EAGAIN if it moved.
+int mpu6050_calibrate(const struct device *i2c_dev, uint16_t num_samples);
+int mpu6050_get_offsets(const struct device *i2c_dev, struct mpu6050_offsets *offsets);
+int mpu6050_set_offsets(const struct device *i2c_dev, const struct mpu6050_offsets *offsets);
+
+// Switch power profile. Only registers whose value changes are written, so
+// switching back and forth costs a few bytes on the bus. The FIFO frame
+// layout needs the gyro, so with the FIFO enabled only FULL and SLEEP are
+// allowed (-EBUSY otherwise). WAKE_ON_MOTION needs CONFIG_APP_MPU6050_INT
+// (-ENOTSUP otherwise).
+int mpu6050_set_power_profile(const struct device *i2c_dev, enum mpu6050_power_profile profile);
+enum mpu6050_power_profile mpu6050_get_power_profile(void);
+
+// Output rate, 4-1000 Hz, as the consumer will read it. The divider is
+// rounded to the nearest rate 1 kHz allows, and the DLPF is set to the
+// widest bandwidth below half that rate so the output is anti-aliased.
+// Can be called at any time; the FIFO is reset if enabled. Returns the
+// rate actually set.
+int mpu6050_set_sample_rate(const struct device *i2c_dev, uint16_t rate_hz);
+uint16_t mpu6050_get_sample_rate(void);
+
+// FIFO batched acquisition. The sensor samples accel and gyro at rate_hz (4-1000)
+// into its 1024-byte FIFO, and mpu6050_fifo_read() drains it in one burst.
+int mpu6050_fifo_enable(const struct device *i2c_dev, uint16_t rate_hz);
+int mpu6050_fifo_disable(const struct device *i2c_dev);
+// Returns the number of samples stored, oldest first, or -EOVERFLOW if the
+// FIFO had overflowed; it is then reset and the next call starts clean.
+int mpu6050_fifo_read(const struct device *i2c_dev, struct mpu6050_sample *samples, size_t max);
+
+// Interrupt-driven sampling on the INT pin (mpu6050-int-gpios in the zephyr,user
+// node). Each data-ready pulse, or each CONFIG_APP_MPU6050_FIFO_WATERMARK pulses
+// in FIFO mode, schedules a read on a dedicated work queue.
+int mpu6050_int_start(const struct device *i2c_dev);
+// Called on the work queue when motion is detected in MPU6050_POWER_WAKE_ON_MOTION
+void mpu6050_set_motion_callback(mpu6050_motion_cb_t cb);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include <zephyr/device.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "MPU6050.h"
+#include "MPU6050_dmp.h"
+#include "i2c.h"
+
+// The image the DMP runs at 200 Hz sensor rate, with gyro at +-2000 deg/s and accel at +-2 g
+#define DMP_SENSOR_RATE_HZ 200
+
+// A quaternion read out of alignment is nowhere near unit length. Checked on
+// the top 16 bits of each component, where 1.0 is 1 << 14.
+#define QUAT_MAG_SQ_NORMAL (1L << 28)
+#define QUAT_MAG_SQ_MIN    (QUAT_MAG_SQ_NORMAL - (1L << 24))
+#define QUAT_MAG_SQ_MAX    (QUAT_MAG_SQ_NORMAL + (1L << 24))
+
+// FIFO_COUNT polls per packet period while waiting for the first packet, and
+// how many packet periods to wait at most
+#define FIRST_PACKET_POLLS_PER_PERIOD 4
+#define FIRST_PACKET_PERIODS          10
+
+static const uint8_t dmp_image[] = {
+#include "mpu6050_dmp.inc"
+};
+
+static bool dmp_enabled;
+static uint8_t packet_buf[MPU6050_FIFO_SIZE];
+static uint8_t bank_buf[DMP_BANK_SIZE];
+
+bool mpu6050_dmp_enabled(void) {
+    return dmp_enabled;
+}
+
+static int32_t be32(const uint8_t *data) {
+    return (int32_t)(((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | (data[2] << 8) | data[3]);
+}
+
+static int16_t be16(const uint8_t *data) {
+    return (int16_t)((data[0] << 8) | data[1]);
+}
+
+// Point MEM_R_W at addr. BANK_SEL and MEM_START_ADDR are adjacent, so one write sets both.
+static int mem_seek(const struct device *i2c_dev, uint16_t addr) {
+    uint8_t bank_addr[2] = { addr >> 8, addr & 0xFF };
+
+    return i2c_write_registers(i2c_dev, MPU6050_ADDR, DMP_BANK_SEL, bank_addr, sizeof(bank_addr));
+}
+
+int mpu6050_dmp_write_mem(const struct device *i2c_dev, uint16_t addr, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t bank_left = DMP_BANK_SIZE - (addr % DMP_BANK_SIZE);
+        size_t n = MIN(MIN(len, (size_t)DMP_CHUNK_SIZE), bank_left);
+
+        int ret = mem_seek(i2c_dev, addr);
+        ret = ret ? ret : i2c_write_registers(i2c_dev, MPU6050_ADDR, DMP_MEM_R_W, data, n);
+        if (ret != 0) {
+            return ret;
+        }
+
+        addr += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int mpu6050_dmp_read_mem(const struct device *i2c_dev, uint16_t addr, uint8_t *data, size_t len) {
+    while (len > 0) {
+        // Reads are limited by the I2C layer's transfer size instead of the write buffer
+        size_t bank_left = DMP_BANK_SIZE - (addr % DMP_BANK_SIZE);
+        size_t n = MIN(MIN(len, (size_t)I2C_MAX_READ_LEN), bank_left);
+
+        int ret = mem_seek(i2c_dev, addr);
+        ret = ret ? ret : i2c_read_registers(i2c_dev, MPU6050_ADDR, DMP_MEM_R_W, data, n);
+        if (ret != 0) {
+            return ret;
+        }
+
+        addr += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int mpu6050_dmp_load(const struct device *i2c_dev, const uint8_t *image, size_t len, uint16_t start_addr) {
+    int ret = mpu6050_dmp_write_mem(i2c_dev, 0, image, len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Verify a bank at a time, mpu6050_dmp_read_mem() splits it into reads
+    for (size_t addr = 0; addr < len; addr += DMP_BANK_SIZE) {
+        size_t n = MIN(len - addr, sizeof(bank_buf));
+
+        ret = mpu6050_dmp_read_mem(i2c_dev, addr, bank_buf, n);
+        if (ret != 0) {
+            return ret;
+        }
+        if (memcmp(bank_buf, &image[addr], n) != 0) {
+            printk("MPU6050 DMP verify failed in bank %u\n", (unsigned)(addr / DMP_BANK_SIZE));
+            return -EIO;
+        }
+    }
+
+    uint8_t start[2] = { start_addr >> 8, start_addr & 0xFF };
+    return i2c_write_registers(i2c_dev, MPU6050_ADDR, DMP_PRGM_START_H, start, sizeof(start));
+}
+
+static int dmp_fifo_reset(const struct device *i2c_dev) {
+    // Like the raw FIFO reset in MPU6050.c, but keeping the DMP running
+    return i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL,
+                              USER_CTRL_DMP_EN | USER_CTRL_FIFO_EN | USER_CTRL_FIFO_RESET);
+}
+
+static int read_fifo_count(const struct device *i2c_dev, uint16_t *count) {
+    uint8_t count_buf[2];
+
+    int ret = i2c_read_registers(i2c_dev, MPU6050_ADDR, FIFO_COUNTH, count_buf, sizeof(count_buf));
+    *count = (count_buf[0] << 8) | count_buf[1];
+    return ret;
+}
+
+// The image decides what goes into a packet and the decoder takes the
+// CONFIG_APP_MPU6050_DMP_* options' word for it, so measure the first packet.
+// With the FIFO polled several times per packet period, the count is one
+// whole packet a poll after it first moves: a packet caught mid-write has
+// finished by then, and the next one is still most of a period away.
+static int check_packet_size(const struct device *i2c_dev) {
+    int32_t poll_us = USEC_PER_SEC / CONFIG_APP_MPU6050_DMP_RATE_HZ / FIRST_PACKET_POLLS_PER_PERIOD;
+    uint16_t count = 0;
+    int ret = 0;
+
+    for (int i = 0; i < FIRST_PACKET_POLLS_PER_PERIOD * FIRST_PACKET_PERIODS && count == 0 && ret == 0; i++) {
+        k_usleep(poll_us);
+        ret = read_fifo_count(i2c_dev, &count);
+    }
+    if (ret == 0 && count != 0) {
+        k_usleep(poll_us);
+        ret = read_fifo_count(i2c_dev, &count);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (count == 0) {
+        printk("MPU6050 DMP wrote no packet in %d ms\n", FIRST_PACKET_PERIODS * 1000 / CONFIG_APP_MPU6050_DMP_RATE_HZ);
+        return -EIO;
+    }
+    if (count != MPU6050_DMP_PACKET_SIZE) {
+        printk("MPU6050 DMP image writes %u byte packets, the CONFIG_APP_MPU6050_DMP_* options give %u\n", count,
+               MPU6050_DMP_PACKET_SIZE);
+        return -EINVAL;
+    }
+
+    // Start the reader on a clean FIFO
+    return dmp_fifo_reset(i2c_dev);
+}
+
+int mpu6050_dmp_init(const struct device *i2c_dev) {
+    int ret;
+
+    if (mpu6050_get_power_profile() != MPU6050_POWER_FULL) {
+        return -EBUSY;
+    }
+
+    ret = mpu6050_set_accel_range(i2c_dev, MPU6050_ACCEL_FS_2G);
+    ret = ret ? ret : mpu6050_set_gyro_range(i2c_dev, MPU6050_GYRO_FS_2000DPS);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = mpu6050_set_sample_rate(i2c_dev, DMP_SENSOR_RATE_HZ);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = mpu6050_dmp_load(i2c_dev, dmp_image, sizeof(dmp_image), CONFIG_APP_MPU6050_DMP_START_ADDR);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Only the DMP writes to the FIFO
+    ret = i2c_write_register_cached(i2c_dev, MPU6050_ADDR, FIFO_EN, 0x00);
+    ret = ret ? ret : i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL,
+                                         USER_CTRL_DMP_RESET | USER_CTRL_FIFO_RESET);
+    ret = ret ? ret : i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL, USER_CTRL_DMP_EN | USER_CTRL_FIFO_EN);
+    ret = ret ? ret : check_packet_size(i2c_dev);
+    if (ret != 0) {
+        // Leave the DMP stopped rather than filling the FIFO for nobody
+        i2c_write_register(i2c_dev, MPU6050_ADDR, USER_CTRL, USER_CTRL_FIFO_RESET);
+        return ret;
+    }
+
+    printk("MPU6050 DMP running (%u byte image, %u byte packets)\n", (unsigned)sizeof(dmp_image),
+           MPU6050_DMP_PACKET_SIZE);
+    dmp_enabled = true;
+    return 0;
+}
+
+// Returns false if the packet is not where a packet should start
+static bool decode_packet(const uint8_t *data, struct mpu6050_dmp_packet *packet) {
+    int64_t mag_sq = 0;
+
+    for (int i = 0; i < 4; i++) {
+        packet->quat[i] = be32(&data[4 * i]);
+        int32_t q14 = packet->quat[i] >> 16;
+        mag_sq += q14 * q14;
+    }
+    if (mag_sq < QUAT_MAG_SQ_MIN || mag_sq > QUAT_MAG_SQ_MAX) {
+        return false;
+    }
+    data += DMP_QUAT_SIZE;
+
+    memset(packet->accel, 0, sizeof(packet->accel));
+    memset(packet->gyro, 0, sizeof(packet->gyro));
+    packet->tap_dir = MPU6050_TAP_NONE;
+    packet->tap_count = 0;
+    packet->orientation = MPU6050_ORIENT_NONE;
+
+#ifdef CONFIG_APP_MPU6050_DMP_ACCEL
+    for (int i = 0; i < 3; i++) {
+        packet->accel[i] = be16(&data[2 * i]);
+    }
+    data += DMP_ACCEL_SIZE;
+#endif
+
+#ifdef CONFIG_APP_MPU6050_DMP_GYRO
+    for (int i = 0; i < 3; i++) {
+        packet->gyro[i] = be16(&data[2 * i]);
+    }
+    data += DMP_GYRO_SIZE;
+#endif
+
+#ifdef CONFIG_APP_MPU6050_DMP_GESTURE
+    // Byte 1 says which events are present, byte 3 holds them:
+    // orientation in bits 7-6, tap direction in 5-3 and count - 1 in 2-0
+    if (data[1] & DMP_GESTURE_TAP) {
+        packet->tap_dir = (data[3] & 0x3F) >> 3;
+        packet->tap_count = (data[3] & 0x07) + 1;
+    }
+    if (data[1] & DMP_GESTURE_ORIENT) {
+        packet->orientation = data[3] >> 6;
+    }
+#endif
+
+    return true;
+}
+
+int mpu6050_dmp_read(const struct device *i2c_dev, struct mpu6050_dmp_packet *packets, size_t max) {
+    uint8_t int_status, count_buf[2];
+    struct i2c_reg_block status_blocks[] = {
+        { INT_STATUS, &int_status, 1 },
+        { FIFO_COUNTH, count_buf, 2 },
+    };
+    int ret;
+
+    if (!dmp_enabled) {
+        return -EINVAL;
+    }
+
+    ret = i2c_read_register_blocks(i2c_dev, MPU6050_ADDR, status_blocks, ARRAY_SIZE(status_blocks));
+    if (ret != 0) {
+        return ret;
+    }
+
+    int64_t now_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    uint16_t count = (count_buf[0] << 8) | count_buf[1];
+
+    if (int_status & INT_STATUS_FIFO_OFLOW) {
+        dmp_fifo_reset(i2c_dev);
+        return -EOVERFLOW;
+    }
+
+    // Like the raw FIFO, a packet the DMP is still writing is left for next time
+
+    size_t available = count / MPU6050_DMP_PACKET_SIZE;
+    size_t n = MIN(available, MIN(max, sizeof(packet_buf) / MPU6050_DMP_PACKET_SIZE));
+    if (n == 0) {
+        return 0;
+    }
+
+    // In I2C_MAX_READ_LEN chunks like the raw FIFO, and likewise reset if one fails
+    ret = i2c_read_fifo(i2c_dev, MPU6050_ADDR, FIFO_R_W, packet_buf, n * MPU6050_DMP_PACKET_SIZE);
+    if (ret != 0) {
+        dmp_fifo_reset(i2c_dev);
+        return ret;
+    }
+
+    int64_t period_us = 1000000 / CONFIG_APP_MPU6050_DMP_RATE_HZ;
+    for (size_t i = 0; i < n; i++) {
+        if (!decode_packet(&packet_buf[i * MPU6050_DMP_PACKET_SIZE], &packets[i])) {
+            dmp_fifo_reset(i2c_dev);
+            return -EOVERFLOW;
+        }
+        packets[i].timestamp_us = now_us - (int64_t)(available - 1 - i) * period_us;
+    }
+
+    return n;
+}
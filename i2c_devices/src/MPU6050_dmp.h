@@ -0,0 +1,95 @@
+#ifndef MPU6050_DMP_H
+#define MPU6050_DMP_H
+
+#include <zephyr/device.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+// Digital Motion Processor support for the MPU6050.
+//
+// The DMP runs a firmware image that has to be uploaded after every power
+// up. The image is InvenSense's and is not part of this repo; point
+// CONFIG_APP_MPU6050_DMP_IMAGE at a raw binary of it (e.g. the one from
+// Motion Driver 6.12) with its output features already configured.
+// The DMP then writes one packet per output period to the FIFO: a Q30
+// quaternion, optionally followed by raw accel, raw gyro and a gesture
+// word with tap and orientation events, in that order. Which ones is up to
+// the image; mpu6050_dmp_init() checks the first packet against the
+// CONFIG_APP_MPU6050_DMP_* options.
+
+// DMP memory and program registers, not in the public register map
+#define DMP_BANK_SEL       0x6D
+#define DMP_MEM_START_ADDR 0x6E
+#define DMP_MEM_R_W        0x6F
+#define DMP_PRGM_START_H   0x70
+
+#define DMP_BANK_SIZE       256
+#define DMP_CHUNK_SIZE      I2C_MAX_WRITE_LEN // Largest MEM_R_W write burst, never across a bank
+#define USER_CTRL_DMP_EN    0x80
+#define USER_CTRL_DMP_RESET 0x08
+
+// Packet parts, in FIFO order
+#define DMP_QUAT_SIZE    16        // w, x, y, z, 32-bit big endian Q30
+#define DMP_ACCEL_SIZE   6
+#define DMP_GYRO_SIZE    6
+#define DMP_GESTURE_SIZE 4
+
+#define DMP_GESTURE_TAP    0x01    // Byte 1 of the gesture word: event sources
+#define DMP_GESTURE_ORIENT 0x08
+
+#define MPU6050_DMP_PACKET_SIZE (DMP_QUAT_SIZE +                                    \
+                                 (IS_ENABLED(CONFIG_APP_MPU6050_DMP_ACCEL) ? DMP_ACCEL_SIZE : 0) + \
+                                 (IS_ENABLED(CONFIG_APP_MPU6050_DMP_GYRO) ? DMP_GYRO_SIZE : 0) +   \
+                                 (IS_ENABLED(CONFIG_APP_MPU6050_DMP_GESTURE) ? DMP_GESTURE_SIZE : 0))
+
+enum mpu6050_tap_dir {
+    MPU6050_TAP_NONE,
+    MPU6050_TAP_X_UP,
+    MPU6050_TAP_X_DOWN,
+    MPU6050_TAP_Y_UP,
+    MPU6050_TAP_Y_DOWN,
+    MPU6050_TAP_Z_UP,
+    MPU6050_TAP_Z_DOWN,
+};
+
+#define MPU6050_ORIENT_NONE 0xFF
+
+struct mpu6050_dmp_packet {
+    int64_t timestamp_us;
+    int32_t quat[4];       // w, x, y, z, 1.0 = 1 << 30
+    int16_t accel[3];      // +-2 g, zero unless CONFIG_APP_MPU6050_DMP_ACCEL
+    int16_t gyro[3];       // +-2000 deg/s, zero unless CONFIG_APP_MPU6050_DMP_GYRO
+    uint8_t tap_dir;       // enum mpu6050_tap_dir
+    uint8_t tap_count;
+    uint8_t orientation;   // Android screen orientation 0-3, or MPU6050_ORIENT_NONE
+};
+
+// DMP memory access, split so no burst crosses a bank or exceeds the I2C layer's limits
+int mpu6050_dmp_write_mem(const struct device *i2c_dev, uint16_t addr, const uint8_t *data, size_t len);
+int mpu6050_dmp_read_mem(const struct device *i2c_dev, uint16_t addr, uint8_t *data, size_t len);
+
+// Upload an image and verify it a bank at a time. Returns -EIO on a mismatch.
+int mpu6050_dmp_load(const struct device *i2c_dev, const uint8_t *image, size_t len, uint16_t start_addr);
+
+#ifdef CONFIG_APP_MPU6050_DMP
+
+// Upload the configured image, set the sensor up the way it expects and start
+// the DMP. Returns -EINVAL if its packets are not the size the options give.
+int mpu6050_dmp_init(const struct device *i2c_dev);
+bool mpu6050_dmp_enabled(void);
+
+// Returns the number of packets stored, oldest first, or -EOVERFLOW if the
+// FIFO overflowed or lost packet alignment; it is then reset.
+int mpu6050_dmp_read(const struct device *i2c_dev, struct mpu6050_dmp_packet *packets, size_t max);
+
+#else
+
+static inline bool mpu6050_dmp_enabled(void) {
+    return false;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include "acquisition.h"
+#include "i2c.h"
+#include <zephyr/device.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/kernel.h>
+
+struct acq_bus {
+    const char *name;
+    const struct device *i2c_dev;
+    const struct acq_reader *readers;
+    size_t num_readers;
+
+    struct k_thread thread;
+    struct k_sem start;
+    struct k_sem done;
+    bool pending; // Started and done not yet taken, only touched by acq_run_tick()
+    uint32_t cycle_us;
+};
+
+K_THREAD_STACK_ARRAY_DEFINE(acq_stacks, ACQ_MAX_BUSES, CONFIG_APP_ACQ_STACK_SIZE);
+
+static struct acq_bus buses[ACQ_MAX_BUSES];
+static int num_buses;
+static uint32_t tick_us;
+
+static void acq_bus_thread(void *p1, void *p2, void *p3) {
+    struct acq_bus *bus = p1;
+
+    while (1) {
+        k_sem_take(&bus->start, K_FOREVER);
+
+        uint32_t start = k_cycle_get_32();
+        uint32_t allowed = 0, started = 0;
+        uint32_t wait_us = 0;
+
+        for (size_t i = 0; i < bus->num_readers; i++) {
+            // Low-priority devices give way when over budget or the bus is busy
+            if (!i2c_device_may_transfer(bus->i2c_dev, bus->readers[i].dev_addr)) {
+                continue;
+            }
+            allowed |= BIT(i);
+
+            if (bus->readers[i].start != NULL) {
+                int ret = bus->readers[i].start(bus->i2c_dev, bus->readers[i].ctx);
+                if (ret >= 0) {
+                    started |= BIT(i);
+                    wait_us = MAX(wait_us, (uint32_t)ret);
+                }
+            }
+        }
+        uint32_t triggered = k_cycle_get_32();
+
+        for (size_t i = 0; i < bus->num_readers; i++) {
+            if ((allowed & BIT(i)) && bus->readers[i].start == NULL) {
+                bus->readers[i].read(bus->i2c_dev, bus->readers[i].ctx);
+            }
+        }
+
+        if (started != 0) {
+            // Counted from the last trigger, so every conversion has had its full time
+            uint32_t elapsed_us = k_cyc_to_us_floor32(k_cycle_get_32() - triggered);
+            if (elapsed_us < wait_us) {
+                k_usleep(wait_us - elapsed_us);
+            }
+            for (size_t i = 0; i < bus->num_readers; i++) {
+                if (started & BIT(i)) {
+                    bus->readers[i].read(bus->i2c_dev, bus->readers[i].ctx);
+                }
+            }
+        }
+        bus->cycle_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+        k_sem_give(&bus->done);
+    }
+}
+
+int acq_add_bus(const char *name, const struct device *i2c_dev, const struct acq_reader *readers, size_t count) {
+    if (num_buses >= ACQ_MAX_BUSES) {
+        return -ENOMEM;
+    }
+    if (count > ACQ_MAX_READERS) {
+        return -EINVAL;
+    }
+
+    struct acq_bus *bus = &buses[num_buses];
+    bus->name = name;
+    bus->i2c_dev = i2c_dev;
+    bus->readers = readers;
+    bus->num_readers = count;
+    k_sem_init(&bus->start, 0, 1);
+    k_sem_init(&bus->done, 0, 1);
+    bus->pending = false;
+
+    k_tid_t tid = k_thread_create(&bus->thread, acq_stacks[num_buses], K_THREAD_STACK_SIZEOF(acq_stacks[num_buses]),
+                                  acq_bus_thread, bus, NULL, NULL, CONFIG_APP_ACQ_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(tid, name);
+
+    return num_buses++;
+}
+
+int acq_run_tick(k_timeout_t timeout) {
+    // A bus left running by a tick that timed out has to finish first, or its
+    // start would be dropped and its done counted for this tick
+    for (int i = 0; i < num_buses; i++) {
+        if (buses[i].pending) {
+            if (k_sem_take(&buses[i].done, timeout) != 0) {
+                return -EBUSY;
+            }
+            buses[i].pending = false;
+        }
+    }
+
+    uint32_t start = k_cycle_get_32();
+
+    for (int i = 0; i < num_buses; i++) {
+        buses[i].pending = true;
+        k_sem_give(&buses[i].start);
+    }
+
+    for (int i = 0; i < num_buses; i++) {
+        if (k_sem_take(&buses[i].done, timeout) != 0) {
+            return -EAGAIN;
+        }
+        buses[i].pending = false;
+    }
+
+    tick_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return 0;
+}
+
+uint32_t acq_bus_cycle_us(int bus) {
+    if (bus < 0 || bus >= num_buses) {
+        return 0;
+    }
+    return buses[bus].cycle_us;
+}
+
+uint32_t acq_tick_us(void) {
+    return tick_us;
+}
+
+void acq_print_cycle_times(void) {
+    for (int i = 0; i < num_buses; i++) {
+        printk("%s cycle: %u us, ", buses[i].name, buses[i].cycle_us);
+    }
+    printk("tick: %u us\n", tick_us);
+}
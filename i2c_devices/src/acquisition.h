@@ -0,0 +1,51 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// One acquisition thread per I2C bus. Every tick, each bus thread runs its own
+// list of sensor read functions, so transfers on different buses overlap and a
+// tick takes as long as the slowest bus instead of the sum of all of them.
+//
+// A reader may also have a start function for sensors that convert on demand.
+// The start functions run first, then the readers without one, so their
+// transfers fill the conversion time. The started readers are read last, once
+// the longest conversion is done.
+//
+// Every entry reads one sensor. Its ctx, e.g. the driver instance, is passed
+// to read and start, so two sensors of a kind on one bus are separate entries.
+
+#define ACQ_MAX_BUSES 2
+#define ACQ_MAX_READERS 32
+
+typedef void (*acq_read_fn_t)(const struct device *i2c_dev, void *ctx);
+// Returns the microseconds until the data can be read, or a negative error to skip the read
+typedef int (*acq_start_fn_t)(const struct device *i2c_dev, void *ctx);
+
+struct acq_reader {
+    acq_read_fn_t read;
+    uint8_t dev_addr; // Checked against the device's bandwidth budget before every read
+    acq_start_fn_t start; // Optional
+    void *ctx;
+};
+
+// Register a bus and the readers to run on it every tick, in order.
+// Must be called before the first acq_run_tick(). Returns the bus index.
+int acq_add_bus(const char *name, const struct device *i2c_dev, const struct acq_reader *readers, size_t count);
+
+// Start one tick on every bus and wait for all of them to finish, up to
+// timeout for each. Returns -EAGAIN if a bus did not finish in time; it goes
+// on in the background and the next tick waits for it, again up to timeout,
+// before starting, or returns -EBUSY without starting.
+int acq_run_tick(k_timeout_t timeout);
+
+// Time the last tick spent on a bus and on the whole tick, in microseconds
+uint32_t acq_bus_cycle_us(int bus);
+uint32_t acq_tick_us(void);
+
+void acq_print_cycle_times(void);
+
+#endif
@@ -0,0 +1,165 @@
+// I2C emulator for the BMP280, register map as used by BMP280.c
+
+#define DT_DRV_COMPAT lunarvitals_bmp280_emul
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_stub_device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "emul_bus_time.h"
+#include "emul_waveform.h"
+#include "../BMP280.h"
+
+#define BMP280_EMUL_CHIP_ID    0x58
+#define BMP280_EMUL_RESET_CMD  0xB6
+#define BMP280_EMUL_ADC_RESET  0x80000 // Data register value before the first conversion
+
+// Calibration example from the BMP280 datasheet, section 3.12
+static const uint8_t bmp280_emul_calib[24] = {
+    0x70, 0x6B, // dig_T1 = 27504
+    0x43, 0x67, // dig_T2 = 26435
+    0x18, 0xFC, // dig_T3 = -1000
+    0x7D, 0x8E, // dig_P1 = 36477
+    0x43, 0xD6, // dig_P2 = -10685
+    0xD0, 0x0B, // dig_P3 = 3024
+    0x27, 0x0B, // dig_P4 = 2855
+    0x8C, 0x00, // dig_P5 = 140
+    0xF9, 0xFF, // dig_P6 = -7
+    0x8C, 0x3C, // dig_P7 = 15500
+    0xF8, 0xC6, // dig_P8 = -14600
+    0x70, 0x17, // dig_P9 = 6000
+};
+
+struct bmp280_emul_cfg {
+    struct emul_waveform adc_t;
+    struct emul_waveform adc_p;
+    uint32_t bus_bitrate;
+};
+
+struct bmp280_emul_data {
+    uint8_t regs[256];
+    uint8_t reg_ptr;
+};
+
+static void put_adc20(uint8_t *buf, uint32_t adc) {
+    buf[0] = (uint8_t)(adc >> 12);
+    buf[1] = (uint8_t)(adc >> 4);
+    buf[2] = (uint8_t)(adc << 4);
+}
+
+static void bmp280_emul_reset(struct bmp280_emul_data *data) {
+    memset(data->regs, 0, sizeof(data->regs));
+    memcpy(&data->regs[BMP280_REG_CALIB_START], bmp280_emul_calib, sizeof(bmp280_emul_calib));
+    data->regs[BMP280_REG_CHIPID] = BMP280_EMUL_CHIP_ID;
+    put_adc20(&data->regs[BMP280_REG_PRESSURE_MSB], BMP280_EMUL_ADC_RESET);
+    put_adc20(&data->regs[BMP280_REG_TEMPERATURE_MSB], BMP280_EMUL_ADC_RESET);
+}
+
+static void bmp280_emul_convert(const struct emul *target) {
+    const struct bmp280_emul_cfg *cfg = target->cfg;
+    struct bmp280_emul_data *data = target->data;
+
+    put_adc20(&data->regs[BMP280_REG_PRESSURE_MSB], emul_waveform_sample(&cfg->adc_p, 0.0f));
+    put_adc20(&data->regs[BMP280_REG_TEMPERATURE_MSB], emul_waveform_sample(&cfg->adc_t, 0.0f));
+}
+
+// Normal mode converts continuously, so the data registers are fresh on every read
+static void bmp280_emul_sample(const struct emul *target) {
+    struct bmp280_emul_data *data = target->data;
+
+    if ((data->regs[BMP280_REG_CONTROL] & BMP280_MODE_MASK) == BMP280_MODE_NORMAL) {
+        bmp280_emul_convert(target);
+    }
+}
+
+static void bmp280_emul_write(const struct emul *target, uint8_t reg, uint8_t value) {
+    struct bmp280_emul_data *data = target->data;
+
+    switch (reg) {
+    case BMP280_REG_SOFTRESET:
+        if (value == BMP280_EMUL_RESET_CMD) {
+            bmp280_emul_reset(data);
+        }
+        break;
+    case BMP280_REG_CONTROL:
+        data->regs[reg] = value;
+        // Forced mode (01 or 10): one conversion, then back to sleep. The
+        // conversion time is not modelled, the result is there right away.
+        if ((value & BMP280_MODE_MASK) != BMP280_MODE_SLEEP && (value & BMP280_MODE_MASK) != BMP280_MODE_NORMAL) {
+            bmp280_emul_convert(target);
+            data->regs[reg] &= ~BMP280_MODE_MASK;
+        }
+        break;
+    case BMP280_REG_CONFIG:
+        data->regs[reg] = value;
+        break;
+    default:
+        // Everything else is read-only
+        break;
+    }
+}
+
+static int bmp280_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr) {
+    const struct bmp280_emul_cfg *cfg = target->cfg;
+    struct bmp280_emul_data *data = target->data;
+
+    emul_bus_time(msgs, num_msgs, cfg->bus_bitrate);
+
+    for (int i = 0; i < num_msgs; i++) {
+        if (msgs[i].flags & I2C_MSG_READ) {
+            bmp280_emul_sample(target);
+            for (uint32_t j = 0; j < msgs[i].len; j++) {
+                msgs[i].buf[j] = data->regs[data->reg_ptr++];
+            }
+        } else if (msgs[i].len > 0) {
+            // In I2C mode the BMP280 takes register/value pairs after the pointer byte
+            data->reg_ptr = msgs[i].buf[0];
+            for (uint32_t j = 1; j < msgs[i].len; j++) {
+                bmp280_emul_write(target, data->reg_ptr, msgs[i].buf[j]);
+                if (j + 1 < msgs[i].len) {
+                    data->reg_ptr = msgs[i].buf[++j];
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int bmp280_emul_init(const struct emul *target, const struct device *parent) {
+    struct bmp280_emul_data *data = target->data;
+
+    bmp280_emul_reset(data);
+    data->reg_ptr = 0;
+    return 0;
+}
+
+static const struct i2c_emul_api bmp280_emul_api = {
+    .transfer = bmp280_emul_transfer,
+};
+
+#define BMP280_EMUL_DEFINE(n)                                                         \
+    static const struct bmp280_emul_cfg bmp280_emul_cfg_##n = {                       \
+        .adc_t = {                                                                    \
+            .offset = DT_INST_PROP(n, adc_temperature),                               \
+            .amplitude = DT_INST_PROP(n, adc_temperature_amplitude),                  \
+            .period_ms = DT_INST_PROP(n, period_ms),                                  \
+        },                                                                            \
+        .adc_p = {                                                                    \
+            .offset = DT_INST_PROP(n, adc_pressure),                                  \
+            .amplitude = DT_INST_PROP(n, adc_pressure_amplitude),                     \
+            .period_ms = DT_INST_PROP(n, period_ms),                                  \
+        },                                                                            \
+        .bus_bitrate = EMUL_BUS_BITRATE(n),                                           \
+    };                                                                                \
+    static struct bmp280_emul_data bmp280_emul_data_##n;                              \
+    EMUL_DT_INST_DEFINE(n, bmp280_emul_init, &bmp280_emul_data_##n,                   \
+                        &bmp280_emul_cfg_##n, &bmp280_emul_api, NULL);                \
+    /* The sensor driver owns the node's device when it is built */                   \
+    COND_CODE_0(IS_ENABLED(CONFIG_APP_SENSOR_DRIVERS),                                \
+                (EMUL_STUB_DEVICE(DT_DRV_INST(n))), ())
+
+DT_INST_FOREACH_STATUS_OKAY(BMP280_EMUL_DEFINE)
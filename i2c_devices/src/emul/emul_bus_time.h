@@ -0,0 +1,28 @@
+#ifndef EMUL_BUS_TIME_H
+#define EMUL_BUS_TIME_H
+
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+// Bus rate of an emulator's controller, for emul_bus_time()
+#define EMUL_BUS_BITRATE(n) DT_PROP_OR(DT_INST_BUS(n), clock_frequency, I2C_BITRATE_STANDARD)
+
+// With CONFIG_APP_EMUL_BUS_TIME, block the caller for as long as the messages
+// would take on a real bus: 9 bit times for the address byte of every message
+// and for every data byte. The caller sleeps, like a thread waiting for the
+// TWIM DMA to finish, so other threads run meanwhile.
+static inline void emul_bus_time(const struct i2c_msg *msgs, int num_msgs, uint32_t bitrate) {
+    uint32_t bytes = 0;
+
+    if (!IS_ENABLED(CONFIG_APP_EMUL_BUS_TIME)) {
+        return;
+    }
+
+    for (int i = 0; i < num_msgs; i++) {
+        bytes += 1 + msgs[i].len;
+    }
+    k_usleep((int32_t)((uint64_t)bytes * 9 * USEC_PER_SEC / bitrate));
+}
+
+#endif
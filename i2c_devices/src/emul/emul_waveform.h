@@ -0,0 +1,26 @@
+#ifndef EMUL_WAVEFORM_H
+#define EMUL_WAVEFORM_H
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <math.h>
+
+#define EMUL_TWO_PI 6.28318531f
+
+// offset + amplitude * sin(2*pi*t / period_ms + phase), shared by the sensor emulators
+struct emul_waveform {
+    int32_t offset;
+    int32_t amplitude;
+    uint32_t period_ms;
+};
+
+static inline int32_t emul_waveform_sample(const struct emul_waveform *w, float phase) {
+    if (w->amplitude == 0 || w->period_ms == 0) {
+        return w->offset;
+    }
+
+    float t = (float)(k_uptime_get() % w->period_ms) / w->period_ms;
+    return w->offset + (int32_t)(w->amplitude * sinf(EMUL_TWO_PI * t + phase));
+}
+
+#endif
@@ -0,0 +1,97 @@
+// SMBus emulator for the MLX90614, answers read-word commands as used by MLX90614.c
+
+#define DT_DRV_COMPAT lunarvitals_mlx90614_emul
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_stub_device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/crc.h>
+#include "emul_bus_time.h"
+#include "emul_waveform.h"
+#include "../MLX90614.h"
+
+struct mlx90614_emul_cfg {
+    int32_t ambient_cc;
+    struct emul_waveform object_cc;
+    uint32_t bus_bitrate;
+};
+
+struct mlx90614_emul_data {
+    uint8_t command;
+};
+
+// RAM temperature format: 0.02 K per LSB
+static uint16_t cc_to_raw(int32_t centi_celsius) {
+    return (uint16_t)((centi_celsius + 27315) / 2);
+}
+
+static int mlx90614_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr) {
+    const struct mlx90614_emul_cfg *cfg = target->cfg;
+    struct mlx90614_emul_data *data = target->data;
+
+    emul_bus_time(msgs, num_msgs, cfg->bus_bitrate);
+
+    for (int i = 0; i < num_msgs; i++) {
+        if (!(msgs[i].flags & I2C_MSG_READ)) {
+            if (msgs[i].len > 0) {
+                data->command = msgs[i].buf[0];
+            }
+            continue;
+        }
+
+        uint16_t word;
+        switch (data->command) {
+        case MLX90614_TA:
+            word = cc_to_raw(cfg->ambient_cc);
+            break;
+        case MLX90614_TOBJ1:
+            word = cc_to_raw(emul_waveform_sample(&cfg->object_cc, 0.0f));
+            break;
+        default:
+            return -EIO;
+        }
+
+        // Read word: LSB, MSB, then PEC over the whole frame including both address bytes
+        uint8_t frame[5] = { addr << 1, data->command, (addr << 1) | 1, word & 0xFF, word >> 8 };
+        uint8_t reply[3] = { frame[3], frame[4], crc8_ccitt(0, frame, sizeof(frame)) };
+
+        for (uint32_t j = 0; j < msgs[i].len; j++) {
+            msgs[i].buf[j] = (j < sizeof(reply)) ? reply[j] : 0xFF;
+        }
+    }
+
+    return 0;
+}
+
+static int mlx90614_emul_init(const struct emul *target, const struct device *parent) {
+    struct mlx90614_emul_data *data = target->data;
+
+    data->command = 0;
+    return 0;
+}
+
+static const struct i2c_emul_api mlx90614_emul_api = {
+    .transfer = mlx90614_emul_transfer,
+};
+
+#define MLX90614_EMUL_DEFINE(n)                                                       \
+    static const struct mlx90614_emul_cfg mlx90614_emul_cfg_##n = {                   \
+        .ambient_cc = DT_INST_PROP(n, ambient_temp_cc),                               \
+        .object_cc = {                                                                \
+            .offset = DT_INST_PROP(n, object_temp_cc),                                \
+            .amplitude = DT_INST_PROP(n, object_amplitude_cc),                        \
+            .period_ms = DT_INST_PROP(n, period_ms),                                  \
+        },                                                                            \
+        .bus_bitrate = EMUL_BUS_BITRATE(n),                                           \
+    };                                                                                \
+    static struct mlx90614_emul_data mlx90614_emul_data_##n;                          \
+    EMUL_DT_INST_DEFINE(n, mlx90614_emul_init, &mlx90614_emul_data_##n,               \
+                        &mlx90614_emul_cfg_##n, &mlx90614_emul_api, NULL);            \
+    /* The sensor driver owns the node's device when it is built */                   \
+    COND_CODE_0(IS_ENABLED(CONFIG_APP_SENSOR_DRIVERS),                                \
+                (EMUL_STUB_DEVICE(DT_DRV_INST(n))), ())
+
+DT_INST_FOREACH_STATUS_OKAY(MLX90614_EMUL_DEFINE)
@@ -0,0 +1,386 @@
+// I2C emulator for the MPU6050, register map as used by MPU6050.c
+
+#define DT_DRV_COMPAT lunarvitals_mpu6050_emul
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_stub_device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "emul_bus_time.h"
+#include "emul_waveform.h"
+#include "../MPU6050.h"
+#include "../MPU6050_dmp.h"
+
+#define MPU6050_EMUL_NUM_REGS 128
+#define MPU6050_EMUL_WHO_AM_I 0x68
+#define MPU6050_EMUL_SLEEP    0x40  // PWR_MGMT_1 reset value, sleep bit set
+#define MPU6050_EMUL_DMP_MEM  4096
+
+// The emulated DMP always sends quaternion, accel, gyro and gesture word,
+// i.e. every CONFIG_APP_MPU6050_DMP_* packet option enabled
+#define MPU6050_EMUL_DMP_PACKET_SIZE (DMP_QUAT_SIZE + DMP_ACCEL_SIZE + DMP_GYRO_SIZE + DMP_GESTURE_SIZE)
+#define MPU6050_EMUL_TAP_EVERY    50   // Packets between emulated taps
+#define MPU6050_EMUL_ORIENT_EVERY 200  // Packets between orientation changes
+
+// The image sets its own packet rate, taken to be the configured one
+#ifdef CONFIG_APP_MPU6050_DMP
+#define MPU6050_EMUL_DMP_RATE_HZ CONFIG_APP_MPU6050_DMP_RATE_HZ
+#else
+#define MPU6050_EMUL_DMP_RATE_HZ 200
+#endif
+
+// Factory accel trims the XA/YA/ZA offset registers come up with
+static const int16_t mpu6050_emul_accel_trim[3] = { -2104, 1318, 1650 };
+
+struct mpu6050_emul_cfg {
+    struct emul_waveform accel[3]; // mg
+    struct emul_waveform gyro[3];  // mdps, offsets are the gyro bias
+    int32_t temperature_mc;
+    struct gpio_dt_spec int_gpio; // Port is NULL when INT is not wired
+    uint32_t bus_bitrate;
+};
+
+struct mpu6050_emul_data {
+    uint8_t regs[MPU6050_EMUL_NUM_REGS];
+    uint8_t reg_ptr;
+
+    // FIFO model: only the byte count is stored, bytes are made up from the
+    // current sample when FIFO_R_W is read
+    uint16_t fifo_count;
+    uint8_t fifo_pos;
+    int64_t fifo_last_ms;
+
+    // DMP memory, the packet being read out and the number of packets read so far
+    uint8_t dmp_mem[MPU6050_EMUL_DMP_MEM];
+    uint8_t dmp_packet[MPU6050_EMUL_DMP_PACKET_SIZE];
+    uint32_t dmp_packets_out;
+
+    // Pulses the INT pin once per sample while data-ready interrupts are enabled
+    struct k_timer int_timer;
+};
+
+static void put_be16(uint8_t *buf, int32_t value) {
+    value = CLAMP(value, INT16_MIN, INT16_MAX);
+    buf[0] = (uint8_t)(value >> 8);
+    buf[1] = (uint8_t)value;
+}
+
+static int16_t get_be16(const uint8_t *buf) {
+    return (int16_t)((buf[0] << 8) | buf[1]);
+}
+
+// Refresh ACCEL/TEMP/GYRO_OUT (0x3B-0x48) from the waveforms and the selected full-scale ranges
+static void mpu6050_emul_sample(const struct emul *target) {
+    const struct mpu6050_emul_cfg *cfg = target->cfg;
+    struct mpu6050_emul_data *data = target->data;
+    uint8_t *out = &data->regs[ACCEL_XOUT_H];
+
+    if (data->regs[PWR_MGMT_1] & MPU6050_EMUL_SLEEP) {
+        return;
+    }
+
+    // 16384 LSB/g at +-2 g, halved for every range step
+    int32_t accel_lsb_per_g = 16384 >> ((data->regs[ACCEL_CONFIG] >> FS_SEL_SHIFT) & 0x3);
+    // 131 LSB/(deg/s) at +-250 deg/s, likewise
+    float gyro_lsb_per_dps = 131.0f / (1 << ((data->regs[GYRO_CONFIG] >> FS_SEL_SHIFT) & 0x3));
+
+    for (int axis = 0; axis < 3; axis++) {
+        float phase = axis * EMUL_TWO_PI / 3.0f;
+        int32_t accel_mg = emul_waveform_sample(&cfg->accel[axis], phase);
+        int32_t gyro_mdps = emul_waveform_sample(&cfg->gyro[axis], phase);
+
+        // Offset registers shift the output by 1/2048 g and 1/32.8 deg/s per LSB,
+        // accel relative to the factory trim
+        int32_t accel_offs = (get_be16(&data->regs[XA_OFFS_H + 2 * axis]) & ~1) - mpu6050_emul_accel_trim[axis];
+        accel_mg += accel_offs * 1000 / 2048;
+        gyro_mdps += get_be16(&data->regs[XG_OFFS_USRH + 2 * axis]) * 10000 / 328;
+
+        put_be16(&out[2 * axis], accel_mg * accel_lsb_per_g / 1000);
+        put_be16(&out[8 + 2 * axis], (int32_t)(gyro_mdps * gyro_lsb_per_dps / 1000.0f));
+    }
+
+    // Temperature in degrees C = TEMP_OUT / 340 + 36.53
+    put_be16(&out[6], (cfg->temperature_mc - 36530) * 340 / 1000);
+}
+
+static void put_be32(uint8_t *buf, int32_t value) {
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+}
+
+static bool mpu6050_emul_dmp_running(const struct mpu6050_emul_data *data) {
+    return (data->regs[USER_CTRL] & USER_CTRL_DMP_EN) != 0;
+}
+
+// Packet n since the DMP started, built when the reader gets to its first
+// byte: a rotation about Z for the packet's own sample time, one turn per
+// waveform period, then the raw accel and gyro and the gesture word. Taps
+// on +Z and orientation changes come at fixed packet intervals, so the
+// decoder sees both.
+static void mpu6050_emul_dmp_packet(const struct emul *target) {
+    const struct mpu6050_emul_cfg *cfg = target->cfg;
+    struct mpu6050_emul_data *data = target->data;
+    uint8_t *packet = data->dmp_packet;
+    uint8_t *gesture = &packet[DMP_QUAT_SIZE + DMP_ACCEL_SIZE + DMP_GYRO_SIZE];
+    uint32_t n = ++data->dmp_packets_out;
+    float angle = 0.0f;
+
+    if (cfg->accel[0].period_ms != 0) {
+        uint64_t period_us = (uint64_t)cfg->accel[0].period_ms * USEC_PER_MSEC;
+        uint64_t t_us = (uint64_t)n * USEC_PER_SEC / MPU6050_EMUL_DMP_RATE_HZ;
+
+        angle = EMUL_TWO_PI * (float)(t_us % period_us) / (float)period_us;
+    }
+
+    put_be32(&packet[0], (int32_t)(cosf(angle / 2) * (1 << 30)));
+    put_be32(&packet[4], 0);
+    put_be32(&packet[8], 0);
+    put_be32(&packet[12], (int32_t)(sinf(angle / 2) * (1 << 30)));
+    memcpy(&packet[DMP_QUAT_SIZE], &data->regs[ACCEL_XOUT_H], DMP_ACCEL_SIZE);
+    memcpy(&packet[DMP_QUAT_SIZE + DMP_ACCEL_SIZE], &data->regs[GYRO_XOUT_H], DMP_GYRO_SIZE);
+
+    memset(gesture, 0, DMP_GESTURE_SIZE);
+    if (n % MPU6050_EMUL_TAP_EVERY == 0) {
+        gesture[1] |= DMP_GESTURE_TAP;
+        gesture[3] |= MPU6050_TAP_Z_UP << 3; // Count 1
+    }
+    if (n % MPU6050_EMUL_ORIENT_EVERY == 0) {
+        gesture[1] |= DMP_GESTURE_ORIENT;
+        gesture[3] |= ((n / MPU6050_EMUL_ORIENT_EVERY) % 4) << 6;
+    }
+}
+
+static uint8_t *mpu6050_emul_dmp_mem_ptr(struct mpu6050_emul_data *data) {
+    uint16_t addr = (data->regs[DMP_BANK_SEL] << 8) | data->regs[DMP_MEM_START_ADDR];
+
+    // MEM_R_W bursts move through the bank
+    data->regs[DMP_MEM_START_ADDR]++;
+    return &data->dmp_mem[addr % MPU6050_EMUL_DMP_MEM];
+}
+
+static uint32_t mpu6050_emul_rate_hz(const struct mpu6050_emul_data *data) {
+    // In cycle mode the accel wakes at the LP_WAKE_CTRL rate, 1.25 Hz rounded down
+    static const uint8_t lp_wake_hz[] = { 1, 5, 20, 40 };
+    if (data->regs[PWR_MGMT_1] & PWR_MGMT_1_CYCLE) {
+        return lp_wake_hz[data->regs[PWR_MGMT_2] >> LP_WAKE_CTRL_SHIFT];
+    }
+
+    // Gyro output rate is 8 kHz with the DLPF off and 1 kHz with it on
+    uint8_t dlpf = data->regs[MPU_CONFIG] & 0x07;
+    return ((dlpf == 0 || dlpf == 7) ? 8000 : 1000) / (1 + data->regs[SMPLRT_DIV]);
+}
+
+// Add the samples taken since the last fill to the FIFO count
+static void mpu6050_emul_fifo_fill(struct mpu6050_emul_data *data) {
+    int64_t now = k_uptime_get();
+
+    bool dmp = mpu6050_emul_dmp_running(data);
+
+    if (!(data->regs[USER_CTRL] & USER_CTRL_FIFO_EN) || (!dmp && data->regs[FIFO_EN] != FIFO_EN_ACCEL_TEMP_GYRO)) {
+        data->fifo_last_ms = now;
+        return;
+    }
+
+    uint32_t rate_hz = dmp ? MPU6050_EMUL_DMP_RATE_HZ : mpu6050_emul_rate_hz(data);
+    int64_t new_samples = (now - data->fifo_last_ms) * rate_hz / 1000;
+
+    if (new_samples == 0) {
+        return;
+    }
+    data->fifo_last_ms += new_samples * 1000 / rate_hz;
+
+    uint32_t frame_size = dmp ? MPU6050_EMUL_DMP_PACKET_SIZE : MPU6050_FIFO_SAMPLE_SIZE;
+    uint32_t count = data->fifo_count + new_samples * frame_size;
+    if (count > MPU6050_FIFO_SIZE) {
+        count = MPU6050_FIFO_SIZE - MPU6050_FIFO_SIZE % frame_size;
+        data->regs[INT_STATUS] |= INT_STATUS_FIFO_OFLOW;
+    }
+    data->fifo_count = count;
+}
+
+static void mpu6050_emul_int_pulse(struct k_timer *timer) {
+    const struct emul *target = k_timer_user_data_get(timer);
+    const struct mpu6050_emul_cfg *cfg = target->cfg;
+    struct mpu6050_emul_data *data = target->data;
+
+    data->regs[INT_STATUS] |= INT_STATUS_DATA_RDY;
+    gpio_emul_input_set(cfg->int_gpio.port, cfg->int_gpio.pin, 1);
+    gpio_emul_input_set(cfg->int_gpio.port, cfg->int_gpio.pin, 0);
+}
+
+// Restart the INT timer after a write that may change the interrupt rate
+static void mpu6050_emul_int_update(const struct emul *target) {
+    const struct mpu6050_emul_cfg *cfg = target->cfg;
+    struct mpu6050_emul_data *data = target->data;
+
+    if (cfg->int_gpio.port == NULL) {
+        return;
+    }
+
+    if ((data->regs[INT_ENABLE] & INT_ENABLE_DATA_RDY) && !(data->regs[PWR_MGMT_1] & MPU6050_EMUL_SLEEP)) {
+        k_timeout_t period = K_USEC(1000000 / mpu6050_emul_rate_hz(data));
+        k_timer_start(&data->int_timer, period, period);
+    } else {
+        k_timer_stop(&data->int_timer);
+    }
+}
+
+static uint8_t mpu6050_emul_read_byte(const struct emul *target, uint8_t reg) {
+    struct mpu6050_emul_data *data = target->data;
+    uint8_t value;
+
+    switch (reg) {
+    case INT_STATUS:
+        value = data->regs[reg];
+        data->regs[reg] = 0; // Cleared on read
+        return value;
+    case FIFO_COUNTH:
+        mpu6050_emul_fifo_fill(data);
+        return data->fifo_count >> 8;
+    case FIFO_COUNTH + 1:
+        return data->fifo_count & 0xFF;
+    case FIFO_R_W:
+        if (data->fifo_count == 0) {
+            return 0xFF;
+        }
+        data->fifo_count--;
+        if (mpu6050_emul_dmp_running(data)) {
+            // A read that starts mid-packet carries on with the same packet
+            if (data->fifo_pos == 0) {
+                mpu6050_emul_dmp_packet(target);
+            }
+            value = data->dmp_packet[data->fifo_pos];
+            data->fifo_pos = (data->fifo_pos + 1) % MPU6050_EMUL_DMP_PACKET_SIZE;
+            return value;
+        }
+        // Frame is ACCEL_XOUT_H..GYRO_ZOUT_L, same as the output registers
+        value = data->regs[ACCEL_XOUT_H + data->fifo_pos];
+        data->fifo_pos = (data->fifo_pos + 1) % MPU6050_FIFO_SAMPLE_SIZE;
+        return value;
+    case DMP_MEM_R_W:
+        return *mpu6050_emul_dmp_mem_ptr(data);
+    default:
+        return data->regs[reg];
+    }
+}
+
+static void mpu6050_emul_write_byte(struct mpu6050_emul_data *data, uint8_t reg, uint8_t value) {
+    switch (reg) {
+    case DEVICE_ID:
+        break;
+    case DMP_MEM_R_W:
+        *mpu6050_emul_dmp_mem_ptr(data) = value;
+        break;
+    case USER_CTRL:
+        if (value & USER_CTRL_FIFO_RESET) {
+            data->fifo_count = 0;
+            data->fifo_pos = 0;
+            data->fifo_last_ms = k_uptime_get();
+        }
+        data->regs[reg] = value & ~(USER_CTRL_FIFO_RESET | USER_CTRL_DMP_RESET);
+        break;
+    default:
+        data->regs[reg] = value;
+        break;
+    }
+}
+
+static int mpu6050_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr) {
+    const struct mpu6050_emul_cfg *cfg = target->cfg;
+    struct mpu6050_emul_data *data = target->data;
+
+    emul_bus_time(msgs, num_msgs, cfg->bus_bitrate);
+
+    for (int i = 0; i < num_msgs; i++) {
+        if (msgs[i].flags & I2C_MSG_READ) {
+            mpu6050_emul_sample(target);
+            for (uint32_t j = 0; j < msgs[i].len; j++) {
+                msgs[i].buf[j] = mpu6050_emul_read_byte(target, data->reg_ptr % MPU6050_EMUL_NUM_REGS);
+                // Burst reads of FIFO_R_W and MEM_R_W stay on the register
+                if (data->reg_ptr != FIFO_R_W && data->reg_ptr != DMP_MEM_R_W) {
+                    data->reg_ptr++;
+                }
+            }
+        } else if (msgs[i].len > 0) {
+            // First byte sets the register pointer, the rest are written from there
+            data->reg_ptr = msgs[i].buf[0];
+            for (uint32_t j = 1; j < msgs[i].len; j++) {
+                mpu6050_emul_write_byte(data, data->reg_ptr % MPU6050_EMUL_NUM_REGS, msgs[i].buf[j]);
+                if (data->reg_ptr != DMP_MEM_R_W) {
+                    data->reg_ptr++;
+                }
+            }
+            if (msgs[i].len > 1) {
+                mpu6050_emul_int_update(target);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int mpu6050_emul_init(const struct emul *target, const struct device *parent) {
+    struct mpu6050_emul_data *data = target->data;
+
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[DEVICE_ID] = MPU6050_EMUL_WHO_AM_I;
+    data->regs[PWR_MGMT_1] = MPU6050_EMUL_SLEEP;
+    for (int axis = 0; axis < 3; axis++) {
+        data->regs[XA_OFFS_H + 2 * axis] = (uint16_t)mpu6050_emul_accel_trim[axis] >> 8;
+        data->regs[XA_OFFS_H + 2 * axis + 1] = mpu6050_emul_accel_trim[axis] & 0xFF;
+    }
+    data->reg_ptr = 0;
+    data->fifo_count = 0;
+    data->fifo_pos = 0;
+    data->fifo_last_ms = k_uptime_get();
+    memset(data->dmp_mem, 0, sizeof(data->dmp_mem));
+    data->dmp_packets_out = 0;
+
+    k_timer_init(&data->int_timer, mpu6050_emul_int_pulse, NULL);
+    k_timer_user_data_set(&data->int_timer, (void *)target);
+    return 0;
+}
+
+static const struct i2c_emul_api mpu6050_emul_api = {
+    .transfer = mpu6050_emul_transfer,
+};
+
+#define MPU6050_EMUL_AXIS(n, axis)                                                    \
+    {                                                                                 \
+        .offset = (int32_t)DT_INST_PROP_BY_IDX(n, accel_mg, axis),                    \
+        .amplitude = DT_INST_PROP(n, accel_amplitude_mg),                             \
+        .period_ms = DT_INST_PROP(n, period_ms),                                      \
+    }
+
+#define MPU6050_EMUL_GYRO_AXIS(n, axis)                                               \
+    {                                                                                 \
+        .offset = (int32_t)DT_INST_PROP_BY_IDX(n, gyro_bias_mdps, axis),              \
+        .amplitude = DT_INST_PROP(n, gyro_amplitude_mdps),                            \
+        .period_ms = DT_INST_PROP(n, period_ms),                                      \
+    }
+
+#define MPU6050_EMUL_DEFINE(n)                                                        \
+    static const struct mpu6050_emul_cfg mpu6050_emul_cfg_##n = {                     \
+        .accel = { MPU6050_EMUL_AXIS(n, 0), MPU6050_EMUL_AXIS(n, 1),                  \
+                   MPU6050_EMUL_AXIS(n, 2) },                                         \
+        .gyro = { MPU6050_EMUL_GYRO_AXIS(n, 0), MPU6050_EMUL_GYRO_AXIS(n, 1),         \
+                  MPU6050_EMUL_GYRO_AXIS(n, 2) },                                     \
+        .temperature_mc = DT_INST_PROP(n, temperature_mc),                            \
+        .int_gpio = GPIO_DT_SPEC_INST_GET_OR(n, int_gpios, {0}),                      \
+        .bus_bitrate = EMUL_BUS_BITRATE(n),                                           \
+    };                                                                                \
+    static struct mpu6050_emul_data mpu6050_emul_data_##n;                            \
+    EMUL_DT_INST_DEFINE(n, mpu6050_emul_init, &mpu6050_emul_data_##n,                 \
+                        &mpu6050_emul_cfg_##n, &mpu6050_emul_api, NULL);              \
+    /* The sensor driver owns the node's device when it is built */                   \
+    COND_CODE_0(IS_ENABLED(CONFIG_APP_SENSOR_DRIVERS),                                \
+                (EMUL_STUB_DEVICE(DT_DRV_INST(n))), ())
+
+DT_INST_FOREACH_STATUS_OKAY(MPU6050_EMUL_DEFINE)
@@ -0,0 +1,482 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/timing/timing.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fusion.h"
+
+#define DEG_TO_RAD 0.017453293f
+#define RAD_TO_DEG 57.29577951f
+
+#define BETA (CONFIG_APP_FUSION_BETA_MILLI / 1000.0f)
+
+// Longer sample spacing (the first sample, polled acquisition, gaps after a
+// FIFO reset) is not integrated. The tilt is set from the accelerometer
+// instead, see tilt_float() and tilt_fixed().
+#define MAX_DT_US 100000
+
+// Float implementation
+
+struct fusion_float {
+    float q[4];
+    int64_t last_us;
+};
+
+static void normalize_float(float *v, int n) {
+    float sum = 0.0f;
+
+    for (int i = 0; i < n; i++) {
+        sum += v[i] * v[i];
+    }
+    if (sum == 0.0f) {
+        return;
+    }
+
+    float recip_norm = 1.0f / sqrtf(sum);
+    for (int i = 0; i < n; i++) {
+        v[i] *= recip_norm;
+    }
+}
+
+// Unit (cos, sin) of half the angle whose cosine and sine are proportional
+// to c and s, which saves the trig: the direction of (|(c, s)| + c, s)
+static void half_angle_float(float c, float s, float h[2]) {
+    float norm = sqrtf(c * c + s * s);
+
+    h[0] = norm + c;
+    h[1] = s;
+    if (norm == 0.0f) {
+        h[0] = 1.0f; // No angle to speak of, e.g. the heading when pointing straight up
+    } else if (h[0] == 0.0f && h[1] == 0.0f) {
+        h[1] = 1.0f; // Half turn
+    } else {
+        normalize_float(h, 2);
+    }
+}
+
+// After a gap the gyro cannot be integrated, so take roll and pitch straight
+// from the accelerometer and keep the yaw. The result is rebuilt as yaw,
+// then pitch, then roll, the order fusion_get_euler() takes apart.
+static void tilt_float(float *q, const float a_in[3]) {
+    float a[3] = { a_in[0], a_in[1], a_in[2] };
+    float roll[2], pitch[2], yaw[2];
+
+    normalize_float(a, 3);
+    half_angle_float(a[2], a[1], roll);
+    half_angle_float(sqrtf(a[1] * a[1] + a[2] * a[2]), -a[0], pitch);
+    half_angle_float(1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]), 2.0f * (q[0] * q[3] + q[1] * q[2]), yaw);
+
+    float t[4] = { pitch[0] * roll[0], pitch[0] * roll[1], pitch[1] * roll[0], -pitch[1] * roll[1] };
+    q[0] = yaw[0] * t[0] - yaw[1] * t[3];
+    q[1] = yaw[0] * t[1] - yaw[1] * t[2];
+    q[2] = yaw[0] * t[2] + yaw[1] * t[1];
+    q[3] = yaw[0] * t[3] + yaw[1] * t[0];
+}
+
+// Madgwick's IMU update: integrate the gyro rate and step along the
+// gradient that aligns the estimated gravity with the measured one
+static void madgwick_float(struct fusion_float *st, const struct mpu6050_sample *sample) {
+    int64_t dt_us = sample->timestamp_us - st->last_us;
+    float a[3], g[3];
+    float *q = st->q;
+
+    st->last_us = sample->timestamp_us;
+    if (dt_us <= 0) {
+        return;
+    }
+
+    mpu6050_accel_to_g(sample, a);
+    if (dt_us > MAX_DT_US) {
+        if (a[0] != 0.0f || a[1] != 0.0f || a[2] != 0.0f) {
+            tilt_float(q, a);
+        }
+        return;
+    }
+
+    mpu6050_gyro_to_dps(sample, g);
+    for (int i = 0; i < 3; i++) {
+        g[i] *= DEG_TO_RAD;
+    }
+
+    float q_dot[4] = {
+        0.5f * (-q[1] * g[0] - q[2] * g[1] - q[3] * g[2]),
+        0.5f * (q[0] * g[0] + q[2] * g[2] - q[3] * g[1]),
+        0.5f * (q[0] * g[1] - q[1] * g[2] + q[3] * g[0]),
+        0.5f * (q[0] * g[2] + q[1] * g[1] - q[2] * g[0]),
+    };
+
+    if (a[0] != 0.0f || a[1] != 0.0f || a[2] != 0.0f) {
+        normalize_float(a, 3);
+
+        float q0q0 = q[0] * q[0], q1q1 = q[1] * q[1], q2q2 = q[2] * q[2], q3q3 = q[3] * q[3];
+        float s[4] = {
+            4.0f * q[0] * q2q2 + 2.0f * q[2] * a[0] + 4.0f * q[0] * q1q1 - 2.0f * q[1] * a[1],
+            4.0f * q[1] * q3q3 - 2.0f * q[3] * a[0] + 4.0f * q0q0 * q[1] - 2.0f * q[0] * a[1] - 4.0f * q[1] +
+                8.0f * q[1] * q1q1 + 8.0f * q[1] * q2q2 + 4.0f * q[1] * a[2],
+            4.0f * q0q0 * q[2] + 2.0f * q[0] * a[0] + 4.0f * q[2] * q3q3 - 2.0f * q[3] * a[1] - 4.0f * q[2] +
+                8.0f * q[2] * q1q1 + 8.0f * q[2] * q2q2 + 4.0f * q[2] * a[2],
+            4.0f * q1q1 * q[3] - 2.0f * q[1] * a[0] + 4.0f * q2q2 * q[3] - 2.0f * q[2] * a[1],
+        };
+        normalize_float(s, 4);
+
+        for (int i = 0; i < 4; i++) {
+            q_dot[i] -= BETA * s[i];
+        }
+    }
+
+    float dt = dt_us * 1e-6f;
+    for (int i = 0; i < 4; i++) {
+        q[i] += q_dot[i] * dt;
+    }
+    normalize_float(q, 4);
+}
+
+// Fixed-point implementation, Q8.24: range +-128, resolution 6e-8
+
+typedef int32_t q24_t;
+
+#define Q24_ONE       (1 << 24)
+#define Q24(x)        ((q24_t)((x) * Q24_ONE))
+
+// Gyro rad/s per LSB for each FS_SEL, in Q0.32 so the small factors keep their precision
+#define GYRO_RAD_Q32(lsb_per_dps) ((int64_t)(DEG_TO_RAD / (lsb_per_dps) * 4294967296.0 + 0.5))
+static const int64_t gyro_rad_per_lsb_q32[] = {
+    GYRO_RAD_Q32(131.0), GYRO_RAD_Q32(65.5), GYRO_RAD_Q32(32.8), GYRO_RAD_Q32(16.4),
+};
+
+struct fusion_fixed {
+    q24_t q[4];
+    int64_t last_us;
+};
+
+static inline q24_t q24_mul(q24_t a, q24_t b) {
+    return (q24_t)(((int64_t)a * b) >> 24);
+}
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+// Scale v to unit length in Q24. The input may be in any Q format.
+static void normalize_fixed(q24_t *v, int n) {
+    uint64_t sum = 0;
+
+    for (int i = 0; i < n; i++) {
+        sum += (int64_t)v[i] * v[i];
+    }
+
+    uint32_t norm = isqrt64(sum);
+    if (norm == 0) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        v[i] = (q24_t)(((int64_t)v[i] << 24) / norm);
+    }
+}
+
+static void half_angle_fixed(q24_t c, q24_t s, q24_t h[2]) {
+    q24_t norm = (q24_t)isqrt64((uint64_t)((int64_t)c * c + (int64_t)s * s));
+
+    h[0] = norm + c;
+    h[1] = s;
+    if (norm == 0) {
+        h[0] = Q24_ONE;
+    } else if (h[0] == 0 && h[1] == 0) {
+        h[1] = Q24_ONE;
+    } else {
+        normalize_fixed(h, 2);
+    }
+}
+
+// Same as tilt_float(), a is in any Q format
+static void tilt_fixed(q24_t *q, const q24_t a_in[3]) {
+    q24_t a[3] = { a_in[0], a_in[1], a_in[2] };
+    q24_t roll[2], pitch[2], yaw[2];
+
+    normalize_fixed(a, 3);
+    half_angle_fixed(a[2], a[1], roll);
+    half_angle_fixed((q24_t)isqrt64((uint64_t)((int64_t)a[1] * a[1] + (int64_t)a[2] * a[2])), -a[0], pitch);
+    half_angle_fixed(Q24_ONE - 2 * (q24_mul(q[2], q[2]) + q24_mul(q[3], q[3])),
+                     2 * (q24_mul(q[0], q[3]) + q24_mul(q[1], q[2])), yaw);
+
+    q24_t t[4] = { q24_mul(pitch[0], roll[0]), q24_mul(pitch[0], roll[1]), q24_mul(pitch[1], roll[0]),
+                   -q24_mul(pitch[1], roll[1]) };
+    q[0] = q24_mul(yaw[0], t[0]) - q24_mul(yaw[1], t[3]);
+    q[1] = q24_mul(yaw[0], t[1]) - q24_mul(yaw[1], t[2]);
+    q[2] = q24_mul(yaw[0], t[2]) + q24_mul(yaw[1], t[1]);
+    q[3] = q24_mul(yaw[0], t[3]) + q24_mul(yaw[1], t[0]);
+}
+
+static void madgwick_fixed(struct fusion_fixed *st, const struct mpu6050_sample *sample) {
+    int64_t dt_us = sample->timestamp_us - st->last_us;
+    q24_t a[3], g[3];
+    q24_t *q = st->q;
+
+    st->last_us = sample->timestamp_us;
+    if (dt_us <= 0) {
+        return;
+    }
+
+    // Only the direction of the accel vector is used, so raw LSBs will do
+    for (int i = 0; i < 3; i++) {
+        a[i] = sample->accel[i];
+        g[i] = (q24_t)((sample->gyro[i] * gyro_rad_per_lsb_q32[sample->gyro_fs]) >> 8);
+    }
+
+    if (dt_us > MAX_DT_US) {
+        if (a[0] != 0 || a[1] != 0 || a[2] != 0) {
+            tilt_fixed(q, a);
+        }
+        return;
+    }
+
+    q24_t q_dot[4] = {
+        (-q24_mul(q[1], g[0]) - q24_mul(q[2], g[1]) - q24_mul(q[3], g[2])) / 2,
+        (q24_mul(q[0], g[0]) + q24_mul(q[2], g[2]) - q24_mul(q[3], g[1])) / 2,
+        (q24_mul(q[0], g[1]) - q24_mul(q[1], g[2]) + q24_mul(q[3], g[0])) / 2,
+        (q24_mul(q[0], g[2]) + q24_mul(q[1], g[1]) - q24_mul(q[2], g[0])) / 2,
+    };
+
+    if (a[0] != 0 || a[1] != 0 || a[2] != 0) {
+        normalize_fixed(a, 3);
+
+        q24_t q0q0 = q24_mul(q[0], q[0]), q1q1 = q24_mul(q[1], q[1]);
+        q24_t q2q2 = q24_mul(q[2], q[2]), q3q3 = q24_mul(q[3], q[3]);
+        q24_t s[4] = {
+            q24_mul(4 * q[0], q2q2) + q24_mul(2 * q[2], a[0]) + q24_mul(4 * q[0], q1q1) - q24_mul(2 * q[1], a[1]),
+            q24_mul(4 * q[1], q3q3) - q24_mul(2 * q[3], a[0]) + q24_mul(4 * q0q0, q[1]) - q24_mul(2 * q[0], a[1]) -
+                4 * q[1] + q24_mul(8 * q[1], q1q1) + q24_mul(8 * q[1], q2q2) + q24_mul(4 * q[1], a[2]),
+            q24_mul(4 * q0q0, q[2]) + q24_mul(2 * q[0], a[0]) + q24_mul(4 * q[2], q3q3) - q24_mul(2 * q[3], a[1]) -
+                4 * q[2] + q24_mul(8 * q[2], q1q1) + q24_mul(8 * q[2], q2q2) + q24_mul(4 * q[2], a[2]),
+            q24_mul(4 * q1q1, q[3]) - q24_mul(2 * q[1], a[0]) + q24_mul(4 * q2q2, q[3]) - q24_mul(2 * q[2], a[1]),
+        };
+        normalize_fixed(s, 4);
+
+        for (int i = 0; i < 4; i++) {
+            q_dot[i] -= q24_mul(Q24(BETA), s[i]);
+        }
+    }
+
+    q24_t dt = (q24_t)((dt_us << 24) / 1000000);
+    for (int i = 0; i < 4; i++) {
+        q[i] += q24_mul(q_dot[i], dt);
+    }
+    normalize_fixed(q, 4);
+}
+
+// Live filter
+
+#ifdef CONFIG_APP_FUSION_FIXED
+static struct fusion_fixed live;
+#define live_update(sample) madgwick_fixed(&live, sample)
+#else
+static struct fusion_float live;
+#define live_update(sample) madgwick_float(&live, sample)
+#endif
+
+static struct k_spinlock lock;
+static struct fusion_stats stats;
+
+void fusion_init(void) {
+    timing_init();
+    timing_start();
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memset(&live, 0, sizeof(live));
+#ifdef CONFIG_APP_FUSION_FIXED
+    live.q[0] = Q24_ONE;
+#else
+    live.q[0] = 1.0f;
+#endif
+    memset(&stats, 0, sizeof(stats));
+    k_spin_unlock(&lock, key);
+}
+
+void fusion_update(const struct mpu6050_sample *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        k_spinlock_key_t key = k_spin_lock(&lock);
+
+        timing_t start = timing_counter_get();
+        live_update(&samples[i]);
+        timing_t end = timing_counter_get();
+
+        uint32_t cycles = (uint32_t)timing_cycles_get(&start, &end);
+        stats.updates++;
+        stats.last_cycles = cycles;
+        stats.max_cycles = MAX(stats.max_cycles, cycles);
+        stats.avg_cycles = (stats.updates == 1) ? cycles : stats.avg_cycles + ((int32_t)(cycles - stats.avg_cycles) / 16);
+
+        k_spin_unlock(&lock, key);
+    }
+}
+
+void fusion_get_quaternion(float q[4]) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    for (int i = 0; i < 4; i++) {
+#ifdef CONFIG_APP_FUSION_FIXED
+        q[i] = (float)live.q[i] / Q24_ONE;
+#else
+        q[i] = live.q[i];
+#endif
+    }
+    k_spin_unlock(&lock, key);
+}
+
+void fusion_get_euler(float euler_deg[3]) {
+    float q[4];
+
+    fusion_get_quaternion(q);
+
+    float sin_pitch = CLAMP(2.0f * (q[0] * q[2] - q[3] * q[1]), -1.0f, 1.0f);
+    euler_deg[0] = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2])) * RAD_TO_DEG;
+    euler_deg[1] = asinf(sin_pitch) * RAD_TO_DEG;
+    euler_deg[2] = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3])) * RAD_TO_DEG;
+}
+
+void fusion_get_stats(struct fusion_stats *out) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *out = stats;
+    k_spin_unlock(&lock, key);
+}
+
+void fusion_print(void) {
+    struct fusion_stats st;
+    float q[4], euler[3];
+
+    fusion_get_quaternion(q);
+    fusion_get_euler(euler);
+    fusion_get_stats(&st);
+
+    printk("Orientation: q=(%.4f, %.4f, %.4f, %.4f) roll=%.1f pitch=%.1f yaw=%.1f\n", (double)q[0], (double)q[1],
+           (double)q[2], (double)q[3], (double)euler[0], (double)euler[1], (double)euler[2]);
+    printk("Fusion (%s): %u updates, %u cycles avg, %u max, %llu ns avg\n",
+           IS_ENABLED(CONFIG_APP_FUSION_FIXED) ? "fixed" : "float", st.updates, st.avg_cycles, st.max_cycles,
+           (unsigned long long)timing_cycles_to_ns(st.avg_cycles));
+}
+
+// Benchmark
+
+#define BENCH_SAMPLES 64
+
+// Slowly tilting and turning sensor at 200 Hz, the same for both implementations
+static void bench_sample(uint32_t i, struct mpu6050_sample *sample) {
+    uint32_t k = i % BENCH_SAMPLES;
+
+    sample->timestamp_us = (int64_t)i * 5000;
+    sample->accel[0] = (int16_t)(k * 37 % 2000) - 1000;
+    sample->accel[1] = (int16_t)(k * 53 % 1600) - 800;
+    sample->accel[2] = 16384 - (int16_t)(k * 11 % 300);
+    sample->gyro[0] = (int16_t)(k * 13 % 400) - 200;
+    sample->gyro[1] = (int16_t)(k * 29 % 600) - 300;
+    sample->gyro[2] = (int16_t)(k * 7 % 200) - 100;
+    sample->temp = 0;
+    sample->accel_fs = MPU6050_ACCEL_FS_2G;
+    sample->gyro_fs = MPU6050_GYRO_FS_250DPS;
+}
+
+static void bench_result(uint32_t n, uint64_t cycles, struct fusion_bench *bench) {
+    bench->updates = n;
+    bench->cycles_per_update = (uint32_t)(cycles / n);
+    bench->ns_per_update = (uint32_t)(timing_cycles_to_ns(cycles) / n);
+}
+
+void fusion_benchmark(uint32_t n, struct fusion_bench *float_bench, struct fusion_bench *fixed_bench) {
+    static struct mpu6050_sample samples[BENCH_SAMPLES];
+    struct fusion_float st_float = { .q = { 1.0f } };
+    struct fusion_fixed st_fixed = { .q = { Q24_ONE } };
+    timing_t start, end;
+    uint64_t cycles_float = 0, cycles_fixed = 0;
+
+    if (n == 0) {
+        return;
+    }
+
+    // Time in blocks of BENCH_SAMPLES so making up the input is not counted
+    for (uint32_t done = 0; done < n;) {
+        uint32_t block = MIN(n - done, BENCH_SAMPLES);
+
+        for (uint32_t i = 0; i < block; i++) {
+            bench_sample(done + i + 1, &samples[i]);
+        }
+
+        start = timing_counter_get();
+        for (uint32_t i = 0; i < block; i++) {
+            madgwick_float(&st_float, &samples[i]);
+        }
+        end = timing_counter_get();
+        cycles_float += timing_cycles_get(&start, &end);
+
+        start = timing_counter_get();
+        for (uint32_t i = 0; i < block; i++) {
+            madgwick_fixed(&st_fixed, &samples[i]);
+        }
+        end = timing_counter_get();
+        cycles_fixed += timing_cycles_get(&start, &end);
+
+        done += block;
+    }
+
+    bench_result(n, cycles_float, float_bench);
+    bench_result(n, cycles_fixed, fixed_bench);
+}
+
+#ifdef CONFIG_SHELL
+
+static int cmd_show(const struct shell *sh, size_t argc, char **argv) {
+    struct fusion_stats st;
+    float q[4], euler[3];
+
+    fusion_get_quaternion(q);
+    fusion_get_euler(euler);
+    fusion_get_stats(&st);
+
+    shell_print(sh, "q = (%.4f, %.4f, %.4f, %.4f)", (double)q[0], (double)q[1], (double)q[2], (double)q[3]);
+    shell_print(sh, "roll %.1f, pitch %.1f, yaw %.1f deg", (double)euler[0], (double)euler[1], (double)euler[2]);
+    shell_print(sh, "%s: %u updates, cycles last %u avg %u max %u", IS_ENABLED(CONFIG_APP_FUSION_FIXED) ? "fixed" : "float",
+                st.updates, st.last_cycles, st.avg_cycles, st.max_cycles);
+    return 0;
+}
+
+static int cmd_bench(const struct shell *sh, size_t argc, char **argv) {
+    uint32_t n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    struct fusion_bench float_bench, fixed_bench;
+
+    if (n == 0) {
+        return -EINVAL;
+    }
+
+    fusion_benchmark(n, &float_bench, &fixed_bench);
+    shell_print(sh, "impl   updates  cycles/update  ns/update");
+    shell_print(sh, "float  %7u  %13u  %9u", float_bench.updates, float_bench.cycles_per_update,
+                float_bench.ns_per_update);
+    shell_print(sh, "fixed  %7u  %13u  %9u", fixed_bench.updates, fixed_bench.cycles_per_update,
+                fixed_bench.ns_per_update);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_fusion,
+    SHELL_CMD(show, NULL, "Orientation and per-update cost of the live filter", cmd_show),
+    SHELL_CMD_ARG(bench, NULL, "Time the float and fixed-point filters [updates]", cmd_bench, 1, 1),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(fusion, &sub_fusion, "IMU orientation fusion", NULL);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "MPU6050.h"
+
+// Madgwick orientation filter on the MPU6050 accel and gyro stream.
+//
+// Two implementations of the same filter are built: a float one for cores
+// with an FPU and a Q8.24 fixed-point one for cores without. The one that
+// runs on the live stream is chosen with CONFIG_APP_FUSION_FLOAT or
+// CONFIG_APP_FUSION_FIXED; fusion_benchmark() times both.
+
+// Per-update cost of the live filter, in CPU cycles
+struct fusion_stats {
+    uint32_t updates;
+    uint32_t last_cycles;
+    uint32_t avg_cycles;  // Moving average over about 16 updates
+    uint32_t max_cycles;
+};
+
+// Result of timing one implementation on a synthetic stream
+struct fusion_bench {
+    uint32_t updates;
+    uint32_t cycles_per_update;
+    uint32_t ns_per_update;
+};
+
+// Reset the filter to the identity orientation and set up cycle counting
+void fusion_init(void);
+
+// Feed samples, oldest first. Matches mpu6050_data_cb_t so it can be
+// registered directly with mpu6050_set_data_callback().
+void fusion_update(const struct mpu6050_sample *samples, size_t count);
+
+// Unit quaternion w, x, y, z rotating the sensor frame into the earth frame
+void fusion_get_quaternion(float q[4]);
+// Roll, pitch and yaw in degrees, computed from the quaternion on request
+void fusion_get_euler(float euler_deg[3]);
+
+void fusion_get_stats(struct fusion_stats *stats);
+
+// Run n updates of each implementation on its own state. The live filter is not touched.
+void fusion_benchmark(uint32_t n, struct fusion_bench *float_bench, struct fusion_bench *fixed_bench);
+
+// Print the orientation and the per-update cost
+void fusion_print(void);
+
+#endif
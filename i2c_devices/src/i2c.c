@@ -1,18 +1,553 @@
 #include "i2c.h"
+#include "i2c_trace.h"
 #include <zephyr/device.h>
 #include <zephyr/drivers/i2c.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+#include <stdio.h>
+
+struct i2c_shadow_reg {
+    uint8_t reg_addr;
+    uint8_t value;
+};
+
+// State kept by this layer for every device it has talked to
+struct i2c_device_state {
+    const struct device *i2c_dev;
+    uint8_t dev_addr;
+
+    struct i2c_shadow_reg shadow[CONFIG_APP_I2C_SHADOW_REGS];
+    uint8_t num_shadow;
+
+    // Circuit breaker
+    uint8_t consecutive_failures;
+    bool quarantined;
+    bool probe_in_flight; // The one transfer let through after the cooldown
+    int64_t quarantine_until_ms;
+
+    // Accounting
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;
+    uint32_t deferrals;
+    uint64_t bus_cycles;
+    uint32_t window_cycles;      // Bus time in the current window
+    uint32_t last_window_cycles; // Bus time in the last complete window
+
+    // Bandwidth budget
+    uint32_t budget_cycles;
+    bool low_priority;
+};
+
+#if defined(CONFIG_I2C_NRFX_TRANSFER_TIMEOUT) && CONFIG_I2C_NRFX_TRANSFER_TIMEOUT > 0
+// The longest read (address, register, repeated start address and data, 9 bit
+// times each) must take at most half the driver timeout at 100 kHz. Otherwise a
+// healthy device times out, is retried and ends up quarantined.
+BUILD_ASSERT((3 + I2C_MAX_READ_LEN) * 9 * 2 * USEC_PER_SEC / I2C_BITRATE_STANDARD <=
+                 CONFIG_I2C_NRFX_TRANSFER_TIMEOUT * USEC_PER_MSEC,
+             "CONFIG_APP_I2C_MAX_READ_LEN does not fit CONFIG_I2C_NRFX_TRANSFER_TIMEOUT");
+#endif
+
+static struct i2c_device_state devices[CONFIG_APP_I2C_MAX_DEVICES];
+static K_MUTEX_DEFINE(devices_lock);
+static int64_t window_start_ms;
+
+// Look up a device, adding it to the table on first use. Call with devices_lock held.
+static struct i2c_device_state *device_state_get(const struct device *i2c_dev, uint8_t dev_addr) {
+    for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+        if (devices[i].i2c_dev == i2c_dev && devices[i].dev_addr == dev_addr) {
+            return &devices[i];
+        }
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+        if (devices[i].i2c_dev == NULL) {
+            devices[i].i2c_dev = i2c_dev;
+            devices[i].dev_addr = dev_addr;
+            return &devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct i2c_shadow_reg *shadow_find(struct i2c_device_state *state, uint8_t reg_addr) {
+    for (int i = 0; i < state->num_shadow; i++) {
+        if (state->shadow[i].reg_addr == reg_addr) {
+            return &state->shadow[i];
+        }
+    }
+    return NULL;
+}
+
+static void shadow_store(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t value) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL) {
+        struct i2c_shadow_reg *entry = shadow_find(state, reg_addr);
+        if (entry == NULL && state->num_shadow < ARRAY_SIZE(state->shadow)) {
+            entry = &state->shadow[state->num_shadow++];
+            entry->reg_addr = reg_addr;
+        }
+        // A full table just means this register is not cached
+        if (entry != NULL) {
+            entry->value = value;
+        }
+    }
+
+    k_mutex_unlock(&devices_lock);
+}
+
+// Returns true and the shadowed value if the register has been written or read before
+static bool shadow_lookup(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *value) {
+    bool found = false;
+
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    struct i2c_shadow_reg *entry = (state != NULL) ? shadow_find(state, reg_addr) : NULL;
+    if (entry != NULL) {
+        *value = entry->value;
+        found = true;
+    }
+
+    k_mutex_unlock(&devices_lock);
+    return found;
+}
+
+// True while transfers to a quarantined device must fail: during the cooldown,
+// and after it while the probe is still on the bus. Call with devices_lock held.
+static bool breaker_blocked(const struct i2c_device_state *state) {
+    return state != NULL && state->quarantined &&
+           (state->probe_in_flight || k_uptime_get() < state->quarantine_until_ms);
+}
+
+// Returns false if the device is quarantined. Once the cooldown has expired
+// exactly one transaction is let through as a probe, the others keep failing
+// until breaker_record() has its result.
+static bool breaker_allow(const struct device *i2c_dev, uint8_t dev_addr) {
+    bool allow;
+
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    allow = !breaker_blocked(state);
+    if (allow && state != NULL && state->quarantined) {
+        state->probe_in_flight = true;
+    }
+
+    k_mutex_unlock(&devices_lock);
+    return allow;
+}
+
+static void breaker_record(const struct device *i2c_dev, uint8_t dev_addr, int result) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL) {
+        state->probe_in_flight = false;
+        if (result == 0) {
+            if (state->quarantined) {
+                printk("I2C device 0x%02X back online\n", dev_addr);
+            }
+            state->consecutive_failures = 0;
+            state->quarantined = false;
+        } else {
+            if (state->consecutive_failures < UINT8_MAX) {
+                state->consecutive_failures++;
+            }
+            // A failed probe re-arms the quarantine straight away
+            if (state->quarantined || state->consecutive_failures >= CONFIG_APP_I2C_BREAKER_THRESHOLD) {
+                if (!state->quarantined) {
+                    printk("I2C device 0x%02X quarantined after %d failures\n", dev_addr, state->consecutive_failures);
+                }
+                state->quarantined = true;
+                state->quarantine_until_ms = k_uptime_get() + CONFIG_APP_I2C_BREAKER_COOLDOWN_MS;
+            }
+        }
+    }
+
+    k_mutex_unlock(&devices_lock);
+}
+
+// Start a new accounting window if the current one is over. Call with devices_lock held.
+static void window_roll(void) {
+    int64_t now = k_uptime_get();
+    int64_t elapsed = now - window_start_ms;
+
+    if (elapsed < CONFIG_APP_I2C_STATS_WINDOW_MS) {
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+        // Nothing was recorded in the windows that went by without a transfer
+        devices[i].last_window_cycles = (elapsed < 2 * CONFIG_APP_I2C_STATS_WINDOW_MS) ? devices[i].window_cycles : 0;
+        devices[i].window_cycles = 0;
+    }
+    window_start_ms = now;
+}
+
+static void stats_record(const struct device *i2c_dev, uint8_t dev_addr, size_t len, uint32_t cycles, int result) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    window_roll();
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL) {
+        state->transactions++;
+        state->bytes += len;
+        state->errors += (result != 0);
+        state->bus_cycles += cycles;
+        state->window_cycles += cycles;
+    }
+
+    k_mutex_unlock(&devices_lock);
+}
+
+static uint8_t window_pct(uint32_t cycles) {
+    uint64_t window_cycles = (uint64_t)sys_clock_hw_cycles_per_sec() * CONFIG_APP_I2C_STATS_WINDOW_MS / 1000;
+    return MIN(100, (uint64_t)cycles * 100 / window_cycles);
+}
+
+// Sum the devices matching the filter into stats. Call with devices_lock held.
+static int stats_collect(const struct device *i2c_dev, int dev_addr, struct i2c_stats *stats) {
+    uint32_t window_cycles = 0;
+    uint64_t bus_cycles = 0;
+    bool found = false;
+
+    memset(stats, 0, sizeof(*stats));
+    window_roll();
+
+    for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+        if (devices[i].i2c_dev != i2c_dev || (dev_addr >= 0 && devices[i].dev_addr != dev_addr)) {
+            continue;
+        }
+        found = true;
+        stats->transactions += devices[i].transactions;
+        stats->bytes += devices[i].bytes;
+        stats->errors += devices[i].errors;
+        stats->deferrals += devices[i].deferrals;
+        bus_cycles += devices[i].bus_cycles;
+        window_cycles += devices[i].last_window_cycles;
+    }
+
+    stats->bus_time_us = k_cyc_to_us_floor64(bus_cycles);
+    stats->utilization_pct = window_pct(window_cycles);
+    return found ? 0 : -ENOENT;
+}
+
+int i2c_device_get_stats(const struct device *i2c_dev, uint8_t dev_addr, struct i2c_stats *stats) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+    int ret = stats_collect(i2c_dev, dev_addr, stats);
+    k_mutex_unlock(&devices_lock);
+    return ret;
+}
+
+int i2c_bus_get_stats(const struct device *i2c_dev, struct i2c_stats *stats) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+    int ret = stats_collect(i2c_dev, -1, stats);
+    k_mutex_unlock(&devices_lock);
+    return ret;
+}
+
+int i2c_device_set_budget(const struct device *i2c_dev, uint8_t dev_addr, uint32_t budget_us, bool low_priority) {
+    int ret = 0;
+
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL) {
+        state->budget_cycles = k_us_to_cyc_ceil32(budget_us);
+        state->low_priority = low_priority;
+    } else {
+        ret = -ENOMEM;
+    }
+
+    k_mutex_unlock(&devices_lock);
+    return ret;
+}
+
+bool i2c_device_may_transfer(const struct device *i2c_dev, uint8_t dev_addr) {
+    bool allow = true;
+
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    window_roll();
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL && state->low_priority) {
+        uint32_t bus_last_window = 0;
+        for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+            if (devices[i].i2c_dev == i2c_dev) {
+                bus_last_window += devices[i].last_window_cycles;
+            }
+        }
+
+        if (state->budget_cycles != 0 && state->window_cycles >= state->budget_cycles) {
+            allow = false;
+        } else if (window_pct(bus_last_window) > CONFIG_APP_I2C_LOW_PRIO_MAX_UTIL) {
+            allow = false;
+        }
+
+        if (!allow) {
+            state->deferrals++;
+        }
+    }
+
+    k_mutex_unlock(&devices_lock);
+    return allow;
+}
+
+// Every transfer in this file goes through here
+static int i2c_xfer(const struct device *i2c_dev, uint8_t dev_addr, struct i2c_msg *msgs, uint8_t num_msgs) {
+    uint32_t backoff_us = CONFIG_APP_I2C_RETRY_BACKOFF_US;
+    int ret;
+
+    // For the trace: register is the first byte written, length counts every byte moved
+    uint8_t reg_addr = (msgs[0].len > 0 && !(msgs[0].flags & I2C_MSG_READ)) ? msgs[0].buf[0] : 0;
+    size_t len = 0;
+    for (uint8_t i = 0; i < num_msgs; i++) {
+        len += msgs[i].len;
+    }
+
+    if (!breaker_allow(i2c_dev, dev_addr)) {
+        uint32_t now = k_cycle_get_32();
+        i2c_trace_record(i2c_dev, dev_addr, reg_addr, len, now, now, -EHOSTDOWN);
+        return -EHOSTDOWN;
+    }
+
+    for (int attempt = 0; ; attempt++) {
+        uint32_t start = k_cycle_get_32();
+        ret = i2c_transfer(i2c_dev, msgs, num_msgs, dev_addr);
+        uint32_t end = k_cycle_get_32();
+        i2c_trace_record(i2c_dev, dev_addr, reg_addr, len, start, end, ret);
+        stats_record(i2c_dev, dev_addr, len, end - start, ret);
+
+        if (ret == 0 || attempt >= CONFIG_APP_I2C_RETRIES) {
+            break;
+        }
+
+        // A slave stuck mid-byte holds SDA low, clock it free before retrying
+        i2c_recover_bus(i2c_dev);
+        // Sleep rather than spin, the other bus threads can use the CPU meanwhile
+        k_usleep(backoff_us);
+        backoff_us *= 2;
+    }
+
+    breaker_record(i2c_dev, dev_addr, ret);
+    return ret;
+}
+
+bool i2c_device_is_quarantined(const struct device *i2c_dev, uint8_t dev_addr) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+    // Only looks, the probe is left for the next transfer
+    bool blocked = breaker_blocked(device_state_get(i2c_dev, dev_addr));
+    k_mutex_unlock(&devices_lock);
+    return blocked;
+}
+
+void i2c_device_reset_breaker(const struct device *i2c_dev, uint8_t dev_addr) {
+    breaker_record(i2c_dev, dev_addr, 0);
+}
 
 int i2c_write_register(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t data) {
     uint8_t buffer[2] = {reg_addr, data};
-    return i2c_write(i2c_dev, buffer, sizeof(buffer), dev_addr);
+    struct i2c_msg msg = {
+        .buf = buffer,
+        .len = sizeof(buffer),
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+
+    return i2c_xfer(i2c_dev, dev_addr, &msg, 1);
+}
+
+int i2c_write_registers(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, const uint8_t *data, size_t len) {
+    uint8_t buffer[1 + I2C_MAX_WRITE_LEN];
+    struct i2c_msg msg = {
+        .buf = buffer,
+        .len = 1 + len,
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+
+    if (len > I2C_MAX_WRITE_LEN) {
+        return -EINVAL;
+    }
+
+    // One buffer so the register address and data go out in a single message
+    buffer[0] = reg_addr;
+    memcpy(&buffer[1], data, len);
+    return i2c_xfer(i2c_dev, dev_addr, &msg, 1);
 }
 
 int i2c_read_register(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data) {
-    return i2c_write_read(i2c_dev, dev_addr, &reg_addr, 1, data, 1);
+    return i2c_read_registers(i2c_dev, dev_addr, reg_addr, data, 1);
 }
 
 int i2c_read_registers(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, size_t len) {
-    return i2c_write_read(i2c_dev, dev_addr, &reg_addr, 1, data, len);
+    struct i2c_msg msgs[2] = {
+        { .buf = &reg_addr, .len = 1, .flags = I2C_MSG_WRITE },
+        { .buf = data, .len = len, .flags = I2C_MSG_READ | I2C_MSG_RESTART | I2C_MSG_STOP },
+    };
+
+    if (len > I2C_MAX_READ_LEN) {
+        return -EINVAL;
+    }
+
+    return i2c_xfer(i2c_dev, dev_addr, msgs, 2);
+}
+
+int i2c_read_fifo(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, size_t len) {
+    // Each chunk is its own transfer, the register pointer stays on the FIFO
+    for (size_t pos = 0; pos < len; pos += I2C_MAX_READ_LEN) {
+        int ret = i2c_read_registers(i2c_dev, dev_addr, reg_addr, &data[pos], MIN(len - pos, I2C_MAX_READ_LEN));
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int i2c_write_register_cached(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t data) {
+    uint8_t current;
+
+    if (shadow_lookup(i2c_dev, dev_addr, reg_addr, &current) && current == data) {
+        return 0;
+    }
+
+    int ret = i2c_write_register(i2c_dev, dev_addr, reg_addr, data);
+    if (ret == 0) {
+        shadow_store(i2c_dev, dev_addr, reg_addr, data);
+    }
+    return ret;
+}
+
+int i2c_update_register_bits(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t mask, uint8_t value) {
+    uint8_t current;
+
+    if (!shadow_lookup(i2c_dev, dev_addr, reg_addr, &current)) {
+        int ret = i2c_read_register(i2c_dev, dev_addr, reg_addr, &current);
+        if (ret != 0) {
+            return ret;
+        }
+        shadow_store(i2c_dev, dev_addr, reg_addr, current);
+    }
+
+    return i2c_write_register_cached(i2c_dev, dev_addr, reg_addr, (current & ~mask) | (value & mask));
+}
+
+int i2c_write_register_pairs(const struct device *i2c_dev, uint8_t dev_addr, const struct i2c_reg_pair *pairs, size_t count) {
+    uint8_t buffer[I2C_MAX_WRITE_LEN];
+    struct i2c_msg msg = {
+        .buf = buffer,
+        .len = 2 * count,
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+
+    if (count == 0 || 2 * count > sizeof(buffer)) {
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        buffer[2 * i] = pairs[i].reg_addr;
+        buffer[2 * i + 1] = pairs[i].value;
+    }
+
+    int ret = i2c_xfer(i2c_dev, dev_addr, &msg, 1);
+    if (ret == 0) {
+        // In order, so a register written twice ends up with its last value
+        for (size_t i = 0; i < count; i++) {
+            shadow_store(i2c_dev, dev_addr, pairs[i].reg_addr, pairs[i].value);
+        }
+    }
+    return ret;
+}
+
+void i2c_shadow_invalidate(const struct device *i2c_dev, uint8_t dev_addr) {
+    k_mutex_lock(&devices_lock, K_FOREVER);
+
+    struct i2c_device_state *state = device_state_get(i2c_dev, dev_addr);
+    if (state != NULL) {
+        state->num_shadow = 0;
+    }
+
+    k_mutex_unlock(&devices_lock);
 }
+
+int i2c_read_register_blocks(const struct device *i2c_dev, uint8_t dev_addr,
+                             const struct i2c_reg_block *blocks, size_t count) {
+    struct i2c_msg msgs[2 * I2C_MAX_REG_BLOCKS];
+    uint8_t reg_addrs[I2C_MAX_REG_BLOCKS];
+
+    size_t len = 0;
+
+    if (count == 0 || count > I2C_MAX_REG_BLOCKS) {
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        len += blocks[i].len;
+    }
+    // One transfer, so it is held to the same limit as a single read
+    if (len > I2C_MAX_READ_LEN) {
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        reg_addrs[i] = blocks[i].reg_addr;
+
+        msgs[2 * i].buf = &reg_addrs[i];
+        msgs[2 * i].len = 1;
+        msgs[2 * i].flags = I2C_MSG_WRITE | (i > 0 ? I2C_MSG_RESTART : 0);
+
+        msgs[2 * i + 1].buf = blocks[i].data;
+        msgs[2 * i + 1].len = blocks[i].len;
+        msgs[2 * i + 1].flags = I2C_MSG_READ | I2C_MSG_RESTART | (i == count - 1 ? I2C_MSG_STOP : 0);
+    }
+
+    return i2c_xfer(i2c_dev, dev_addr, msgs, 2 * count);
+}
+
+#ifdef CONFIG_SHELL
+
+static void print_stats_row(const struct shell *sh, const char *bus, const char *who, const struct i2c_stats *stats) {
+    shell_print(sh, "%-8s %-6s %8u %9u %6u %6u %10llu %4u%%", bus, who, stats->transactions, stats->bytes,
+                stats->errors, stats->deferrals, (unsigned long long)stats->bus_time_us, stats->utilization_pct);
+}
+
+static int cmd_i2c_stats(const struct shell *sh, size_t argc, char **argv) {
+    struct i2c_stats stats;
+    char addr[8];
+
+    shell_print(sh, "bus      device   xfers     bytes errors defers  bus_us      util");
+
+    k_mutex_lock(&devices_lock, K_FOREVER);
+    for (size_t i = 0; i < ARRAY_SIZE(devices); i++) {
+        if (devices[i].i2c_dev == NULL) {
+            continue;
+        }
+
+        snprintf(addr, sizeof(addr), "0x%02X", devices[i].dev_addr);
+        stats_collect(devices[i].i2c_dev, devices[i].dev_addr, &stats);
+        print_stats_row(sh, devices[i].i2c_dev->name, addr, &stats);
+
+        // Bus total after the last device on that bus
+        bool last_on_bus = true;
+        for (size_t j = i + 1; j < ARRAY_SIZE(devices); j++) {
+            if (devices[j].i2c_dev == devices[i].i2c_dev) {
+                last_on_bus = false;
+            }
+        }
+        if (last_on_bus) {
+            stats_collect(devices[i].i2c_dev, -1, &stats);
+            print_stats_row(sh, devices[i].i2c_dev->name, "total", &stats);
+        }
+    }
+    k_mutex_unlock(&devices_lock);
+
+    return 0;
+}
+
+SHELL_CMD_REGISTER(i2c_stats, NULL, "I2C bus and device accounting", cmd_i2c_stats);
+
+#endif
@@ -4,10 +4,79 @@
 #include <zephyr/device.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+// Maximum number of blocks accepted by i2c_read_register_blocks()
+#define I2C_MAX_REG_BLOCKS 4
+// Maximum data length accepted by i2c_write_registers()
+#define I2C_MAX_WRITE_LEN 16
+// Maximum data length accepted by i2c_read_registers() and i2c_read_register_blocks()
+#define I2C_MAX_READ_LEN CONFIG_APP_I2C_MAX_READ_LEN
+
+// One register range to read as part of a multi-message transfer
+struct i2c_reg_block {
+    uint8_t reg_addr;
+    uint8_t *data;
+    size_t len;
+};
+
+// One register write in a batch sent by i2c_write_register_pairs()
+struct i2c_reg_pair {
+    uint8_t reg_addr;
+    uint8_t value;
+};
 
 // General I2C read/write functions
 int i2c_write_register(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t data);
 int i2c_read_register(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data);
 int i2c_read_registers(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, size_t len);
+// Drain len bytes from a FIFO data register that does not auto-increment, in
+// transfers of at most I2C_MAX_READ_LEN bytes. Stops at the first failed transfer.
+int i2c_read_fifo(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, size_t len);
+// Burst write of up to I2C_MAX_WRITE_LEN bytes starting at reg_addr, not shadowed
+int i2c_write_registers(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, const uint8_t *data, size_t len);
+
+// Register shadow: remembers what was written so unchanged writes are skipped.
+// Write-only trigger registers (soft reset and the like) should use the plain
+// i2c_write_register() and then i2c_shadow_invalidate() the device.
+int i2c_write_register_cached(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t data);
+// Replace the bits in mask with value. Reads the register only if it is not shadowed yet.
+int i2c_update_register_bits(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, uint8_t mask, uint8_t value);
+// Several register/value pairs in one message, for devices that take writes in
+// pairs rather than auto-incrementing (BMP280). Up to I2C_MAX_WRITE_LEN / 2
+// pairs, all sent even if shadowed, and shadowed once written.
+int i2c_write_register_pairs(const struct device *i2c_dev, uint8_t dev_addr, const struct i2c_reg_pair *pairs, size_t count);
+void i2c_shadow_invalidate(const struct device *i2c_dev, uint8_t dev_addr);
+
+// Error recovery: every transfer is retried with backoff and a bus clear, and
+// a device that keeps failing is quarantined (transfers return -EHOSTDOWN
+// without touching the bus) until its cooldown expires.
+bool i2c_device_is_quarantined(const struct device *i2c_dev, uint8_t dev_addr);
+void i2c_device_reset_breaker(const struct device *i2c_dev, uint8_t dev_addr);
+
+// Bus accounting, kept per device and summed per bus
+struct i2c_stats {
+    uint32_t transactions;   // Transfer attempts, retries included
+    uint32_t bytes;
+    uint32_t errors;
+    uint32_t deferrals;      // Reads skipped by i2c_device_may_transfer()
+    uint64_t bus_time_us;
+    uint8_t utilization_pct; // Share of the last complete window spent on the bus
+};
+
+int i2c_device_get_stats(const struct device *i2c_dev, uint8_t dev_addr, struct i2c_stats *stats);
+int i2c_bus_get_stats(const struct device *i2c_dev, struct i2c_stats *stats);
+
+// Bandwidth budget: a low-priority device is deferred once it has used budget_us
+// of bus time in the current window (0 = no limit), or while its bus was busier
+// than CONFIG_APP_I2C_LOW_PRIO_MAX_UTIL in the last window.
+int i2c_device_set_budget(const struct device *i2c_dev, uint8_t dev_addr, uint32_t budget_us, bool low_priority);
+// Asked by the scheduler before reading a device; counts a deferral when it says no
+bool i2c_device_may_transfer(const struct device *i2c_dev, uint8_t dev_addr);
+
+// Read several register ranges from one device in a single i2c_transfer() call,
+// chaining the write-address/read pairs with repeated starts
+int i2c_read_register_blocks(const struct device *i2c_dev, uint8_t dev_addr,
+                             const struct i2c_reg_block *blocks, size_t count);
 
 #endif
@@ -0,0 +1,112 @@
+#include "i2c_async.h"
+#include "i2c.h"
+#include <zephyr/device.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/kernel.h>
+
+static K_FIFO_DEFINE(i2c_async_queue);
+
+static void txn_init(struct i2c_async_txn *txn, const struct device *i2c_dev, uint8_t dev_addr,
+                     uint8_t reg_addr, enum i2c_async_op op, i2c_async_cb_t cb, void *user_data) {
+    txn->i2c_dev = i2c_dev;
+    txn->dev_addr = dev_addr;
+    txn->reg_addr = reg_addr;
+    txn->op = op;
+    txn->cb = cb;
+    txn->user_data = user_data;
+    txn->result = 0;
+    atomic_set(&txn->state, I2C_ASYNC_IDLE);
+    k_sem_init(&txn->done, 0, 1);
+}
+
+void i2c_async_write_init(struct i2c_async_txn *txn, const struct device *i2c_dev, uint8_t dev_addr,
+                          uint8_t reg_addr, uint8_t value, i2c_async_cb_t cb, void *user_data) {
+    txn_init(txn, i2c_dev, dev_addr, reg_addr, I2C_ASYNC_WRITE_REG, cb, user_data);
+    txn->value = value;
+    txn->data = NULL;
+    txn->len = 1;
+}
+
+void i2c_async_read_init(struct i2c_async_txn *txn, const struct device *i2c_dev, uint8_t dev_addr,
+                         uint8_t reg_addr, uint8_t *data, size_t len, i2c_async_cb_t cb, void *user_data) {
+    txn_init(txn, i2c_dev, dev_addr, reg_addr, I2C_ASYNC_READ_REGS, cb, user_data);
+    txn->value = 0;
+    txn->data = data;
+    txn->len = len;
+}
+
+int i2c_async_submit(struct i2c_async_txn *txn) {
+    atomic_val_t state = atomic_get(&txn->state);
+
+    if (state == I2C_ASYNC_QUEUED || state == I2C_ASYNC_ACTIVE) {
+        return -EBUSY;
+    }
+    if (!atomic_cas(&txn->state, state, I2C_ASYNC_QUEUED)) {
+        return -EBUSY;
+    }
+
+    k_sem_reset(&txn->done);
+    k_fifo_put(&i2c_async_queue, txn);
+    return 0;
+}
+
+bool i2c_async_poll(struct i2c_async_txn *txn, int *result) {
+    atomic_val_t state = atomic_get(&txn->state);
+
+    if (state != I2C_ASYNC_DONE && state != I2C_ASYNC_CANCELLED) {
+        return false;
+    }
+    if (result != NULL) {
+        *result = txn->result;
+    }
+    return true;
+}
+
+int i2c_async_wait(struct i2c_async_txn *txn, k_timeout_t timeout) {
+    if (k_sem_take(&txn->done, timeout) != 0) {
+        return -EAGAIN;
+    }
+    return txn->result;
+}
+
+int i2c_async_cancel(struct i2c_async_txn *txn) {
+    if (!atomic_cas(&txn->state, I2C_ASYNC_QUEUED, I2C_ASYNC_CANCELLED)) {
+        return (atomic_get(&txn->state) == I2C_ASYNC_ACTIVE) ? -EINPROGRESS : -EALREADY;
+    }
+
+    // The worker skips cancelled entries anyway, this just frees the slot early
+    k_queue_remove(&i2c_async_queue._queue, txn);
+    txn->result = -ECANCELED;
+    k_sem_give(&txn->done);
+    return 0;
+}
+
+static void i2c_async_worker(void *p1, void *p2, void *p3) {
+    while (1) {
+        struct i2c_async_txn *txn = k_fifo_get(&i2c_async_queue, K_FOREVER);
+
+        // Lost the race against i2c_async_cancel()
+        if (!atomic_cas(&txn->state, I2C_ASYNC_QUEUED, I2C_ASYNC_ACTIVE)) {
+            continue;
+        }
+
+        int ret;
+        if (txn->op == I2C_ASYNC_WRITE_REG) {
+            ret = i2c_write_register(txn->i2c_dev, txn->dev_addr, txn->reg_addr, txn->value);
+        } else {
+            ret = i2c_read_registers(txn->i2c_dev, txn->dev_addr, txn->reg_addr, txn->data, txn->len);
+        }
+
+        // Callback runs before pollers and waiters see completion, so the
+        // transaction still belongs to us until the state changes below
+        txn->result = ret;
+        if (txn->cb != NULL) {
+            txn->cb(txn, ret, txn->user_data);
+        }
+        atomic_set(&txn->state, I2C_ASYNC_DONE);
+        k_sem_give(&txn->done);
+    }
+}
+
+K_THREAD_DEFINE(i2c_async_tid, CONFIG_APP_I2C_ASYNC_STACK_SIZE, i2c_async_worker, NULL, NULL, NULL,
+                CONFIG_APP_I2C_ASYNC_PRIORITY, 0, 0);
@@ -0,0 +1,73 @@
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Asynchronous front end for the helpers in i2c.h.
+//
+// A transaction is described by a caller-owned struct i2c_async_txn, queued
+// with i2c_async_submit() and run by a worker thread. The caller can then do
+// other work and either get a callback (run on the worker thread, must not
+// resubmit the same transaction), poll with i2c_async_poll() or block with
+// i2c_async_wait(). A transaction that has not started yet can be pulled
+// back with i2c_async_cancel().
+
+enum i2c_async_op {
+    I2C_ASYNC_WRITE_REG,
+    I2C_ASYNC_READ_REGS,
+};
+
+enum i2c_async_state {
+    I2C_ASYNC_IDLE,
+    I2C_ASYNC_QUEUED,
+    I2C_ASYNC_ACTIVE,
+    I2C_ASYNC_DONE,
+    I2C_ASYNC_CANCELLED,
+};
+
+struct i2c_async_txn;
+
+typedef void (*i2c_async_cb_t)(struct i2c_async_txn *txn, int result, void *user_data);
+
+struct i2c_async_txn {
+    void *fifo_reserved; // Used by the kernel FIFO, must be first
+
+    const struct device *i2c_dev;
+    uint8_t dev_addr;
+    uint8_t reg_addr;
+    enum i2c_async_op op;
+    uint8_t value;   // Byte to write for I2C_ASYNC_WRITE_REG
+    uint8_t *data;   // Destination for I2C_ASYNC_READ_REGS
+    size_t len;
+
+    i2c_async_cb_t cb;
+    void *user_data;
+
+    atomic_t state;
+    int result;
+    struct k_sem done;
+};
+
+void i2c_async_write_init(struct i2c_async_txn *txn, const struct device *i2c_dev, uint8_t dev_addr,
+                          uint8_t reg_addr, uint8_t value, i2c_async_cb_t cb, void *user_data);
+void i2c_async_read_init(struct i2c_async_txn *txn, const struct device *i2c_dev, uint8_t dev_addr,
+                         uint8_t reg_addr, uint8_t *data, size_t len, i2c_async_cb_t cb, void *user_data);
+
+// Queue a transaction. Returns -EBUSY if it is already queued or running.
+int i2c_async_submit(struct i2c_async_txn *txn);
+
+// Returns true once the transaction has finished or was cancelled, and stores its result.
+bool i2c_async_poll(struct i2c_async_txn *txn, int *result);
+
+// Block until the transaction finishes. Returns its result, or -EAGAIN on timeout.
+int i2c_async_wait(struct i2c_async_txn *txn, k_timeout_t timeout);
+
+// Remove a queued transaction. Returns -EINPROGRESS if it has already started
+// and -EALREADY if it has finished.
+int i2c_async_cancel(struct i2c_async_txn *txn);
+
+#endif
@@ -0,0 +1,89 @@
+#include "i2c_plan.h"
+#include "i2c.h"
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+void i2c_plan_init(struct i2c_read_plan *plan, const struct device *i2c_dev, uint8_t dev_addr) {
+    plan->i2c_dev = i2c_dev;
+    plan->dev_addr = dev_addr;
+    plan->num_ranges = 0;
+    plan->num_bursts = 0;
+}
+
+int i2c_plan_add(struct i2c_read_plan *plan, uint8_t reg_addr, uint8_t len) {
+    if (plan->num_ranges >= I2C_PLAN_MAX_RANGES) {
+        return -ENOMEM;
+    }
+    if (len == 0) {
+        return -EINVAL;
+    }
+
+    struct i2c_plan_range *range = &plan->ranges[plan->num_ranges];
+    range->reg_addr = reg_addr;
+    range->len = len;
+    range->offset = 0;
+
+    // Invalidates any earlier build
+    plan->num_bursts = 0;
+    return plan->num_ranges++;
+}
+
+int i2c_plan_build(struct i2c_read_plan *plan) {
+    uint8_t order[I2C_PLAN_MAX_RANGES];
+    size_t used = 0;
+
+    // Visit the ranges by register address; insertion sort, there are only a handful
+    for (size_t i = 0; i < plan->num_ranges; i++) {
+        size_t j = i;
+        while (j > 0 && plan->ranges[order[j - 1]].reg_addr > plan->ranges[i].reg_addr) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    plan->num_bursts = 0;
+    for (size_t i = 0; i < plan->num_ranges; i++) {
+        struct i2c_plan_range *range = &plan->ranges[order[i]];
+        struct i2c_reg_block *burst = (plan->num_bursts > 0) ? &plan->bursts[plan->num_bursts - 1] : NULL;
+
+        if (burst != NULL) {
+            unsigned int burst_end = burst->reg_addr + burst->len;
+
+            // Overlaps or close enough to read through the gap
+            if (range->reg_addr < burst_end + I2C_PLAN_BURST_OVERHEAD) {
+                unsigned int range_end = range->reg_addr + range->len;
+                if (range_end > burst_end) {
+                    size_t grow = range_end - burst_end;
+                    if (used + grow > I2C_PLAN_BUF_SIZE) {
+                        return -ENOMEM;
+                    }
+                    burst->len += grow;
+                    used += grow;
+                }
+                range->offset = (burst->data - plan->buf) + (range->reg_addr - burst->reg_addr);
+                continue;
+            }
+        }
+
+        if (plan->num_bursts >= I2C_MAX_REG_BLOCKS || used + range->len > I2C_PLAN_BUF_SIZE) {
+            return -ENOMEM;
+        }
+
+        burst = &plan->bursts[plan->num_bursts++];
+        burst->reg_addr = range->reg_addr;
+        burst->data = &plan->buf[used];
+        burst->len = range->len;
+        range->offset = used;
+        used += range->len;
+    }
+
+    return 0;
+}
+
+int i2c_plan_execute(struct i2c_read_plan *plan) {
+    if (plan->num_bursts == 0) {
+        return -EINVAL;
+    }
+    return i2c_read_register_blocks(plan->i2c_dev, plan->dev_addr, plan->bursts, plan->num_bursts);
+}
@@ -0,0 +1,56 @@
+#ifndef I2C_PLAN_H
+#define I2C_PLAN_H
+
+#include <zephyr/device.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "i2c.h"
+
+// Burst-read planner. A driver lists the register ranges it needs every tick,
+// the planner merges adjacent and nearly adjacent ranges into as few bursts as
+// possible and reads them in one transfer. Each range is then handed back as a
+// slice of the shared buffer, without copying.
+
+#define I2C_PLAN_MAX_RANGES 8
+#define I2C_PLAN_BUF_SIZE   32
+
+// Cost of starting another burst in the same transfer, in bytes on the wire:
+// repeated start + address, register byte, repeated start + address
+#define I2C_PLAN_BURST_OVERHEAD 3
+
+struct i2c_plan_range {
+    uint8_t reg_addr;
+    uint8_t len;
+    uint8_t offset; // Into i2c_read_plan.buf, set by i2c_plan_build()
+};
+
+struct i2c_read_plan {
+    const struct device *i2c_dev;
+    uint8_t dev_addr;
+
+    struct i2c_plan_range ranges[I2C_PLAN_MAX_RANGES];
+    size_t num_ranges;
+
+    struct i2c_reg_block bursts[I2C_MAX_REG_BLOCKS];
+    size_t num_bursts;
+
+    uint8_t buf[I2C_PLAN_BUF_SIZE];
+};
+
+void i2c_plan_init(struct i2c_read_plan *plan, const struct device *i2c_dev, uint8_t dev_addr);
+
+// Add a register range. Returns a handle for i2c_plan_slice() or a negative errno.
+int i2c_plan_add(struct i2c_read_plan *plan, uint8_t reg_addr, uint8_t len);
+
+// Merge the ranges into bursts. Two ranges are merged when the bytes between
+// them cost less to read than I2C_PLAN_BURST_OVERHEAD.
+int i2c_plan_build(struct i2c_read_plan *plan);
+
+// Read every burst in a single transfer
+int i2c_plan_execute(struct i2c_read_plan *plan);
+
+static inline const uint8_t *i2c_plan_slice(const struct i2c_read_plan *plan, int handle) {
+    return &plan->buf[plan->ranges[handle].offset];
+}
+
+#endif
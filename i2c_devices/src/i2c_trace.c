@@ -0,0 +1,118 @@
+#include "i2c_trace.h"
+#include <zephyr/device.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_APP_I2C_TRACE_SIZE), "CONFIG_APP_I2C_TRACE_SIZE must be a power of two");
+
+#define TRACE_MASK (CONFIG_APP_I2C_TRACE_SIZE - 1)
+
+static struct i2c_trace_entry trace_ring[CONFIG_APP_I2C_TRACE_SIZE];
+static atomic_t trace_head; // Total number of entries ever recorded
+
+void i2c_trace_record(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, size_t len,
+                      uint32_t start_cycles, uint32_t end_cycles, int result) {
+    // Claiming the slot is the only shared step, so writers never block each other
+    struct i2c_trace_entry *entry = &trace_ring[atomic_inc(&trace_head) & TRACE_MASK];
+
+    entry->i2c_dev = i2c_dev;
+    entry->start_cycles = start_cycles;
+    entry->end_cycles = end_cycles;
+    entry->len = MIN(len, UINT16_MAX);
+    entry->dev_addr = dev_addr;
+    entry->reg_addr = reg_addr;
+    entry->result = result;
+}
+
+size_t i2c_trace_snapshot(struct i2c_trace_entry *out, size_t max) {
+    uint32_t head = atomic_get(&trace_head);
+    uint32_t count = MIN(head, CONFIG_APP_I2C_TRACE_SIZE);
+
+    count = MIN(count, max);
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = trace_ring[(head - count + i) & TRACE_MASK];
+    }
+    return count;
+}
+
+void i2c_trace_clear(void) {
+    atomic_clear(&trace_head);
+}
+
+#ifdef CONFIG_SHELL
+
+// Shell commands run one at a time, so the scratch buffers can be static
+static struct i2c_trace_entry snapshot[CONFIG_APP_I2C_TRACE_SIZE];
+static uint32_t latencies[CONFIG_APP_I2C_TRACE_SIZE];
+static bool counted[CONFIG_APP_I2C_TRACE_SIZE];
+
+static uint32_t entry_us(const struct i2c_trace_entry *entry) {
+    return k_cyc_to_us_floor32(entry->end_cycles - entry->start_cycles);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv) {
+    size_t max = (argc > 1) ? strtoul(argv[1], NULL, 0) : ARRAY_SIZE(snapshot);
+    size_t count = i2c_trace_snapshot(snapshot, MIN(max, ARRAY_SIZE(snapshot)));
+
+    shell_print(sh, "bus      addr reg  len  start_cyc   us  result");
+    for (size_t i = 0; i < count; i++) {
+        const struct i2c_trace_entry *entry = &snapshot[i];
+        shell_print(sh, "%-8s 0x%02X 0x%02X %4u %10u %4u  %d", entry->i2c_dev->name, entry->dev_addr,
+                    entry->reg_addr, entry->len, entry->start_cycles, entry_us(entry), entry->result);
+    }
+    return 0;
+}
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv) {
+    size_t count = i2c_trace_snapshot(snapshot, ARRAY_SIZE(snapshot));
+
+    memset(counted, 0, sizeof(counted));
+    shell_print(sh, "bus      addr     n  errors   p50   p90   p99   max (us)");
+    for (size_t i = 0; i < count; i++) {
+        if (counted[i]) {
+            continue;
+        }
+
+        // Collect every entry for this device, then sort for the percentiles
+        size_t n = 0;
+        uint32_t errors = 0;
+        for (size_t j = i; j < count; j++) {
+            if (snapshot[j].i2c_dev == snapshot[i].i2c_dev && snapshot[j].dev_addr == snapshot[i].dev_addr) {
+                latencies[n++] = entry_us(&snapshot[j]);
+                errors += (snapshot[j].result != 0);
+                counted[j] = true;
+            }
+        }
+        qsort(latencies, n, sizeof(latencies[0]), cmp_u32);
+
+        shell_print(sh, "%-8s 0x%02X %5zu %7u %5u %5u %5u %5u", snapshot[i].i2c_dev->name, snapshot[i].dev_addr,
+                    n, errors, latencies[n * 50 / 100], latencies[n * 90 / 100], latencies[n * 99 / 100],
+                    latencies[n - 1]);
+    }
+    return 0;
+}
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv) {
+    i2c_trace_clear();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_i2c_trace,
+    SHELL_CMD_ARG(dump, NULL, "Dump traced transfers, oldest first [max entries]", cmd_dump, 1, 1),
+    SHELL_CMD(stats, NULL, "Latency percentiles per device", cmd_stats),
+    SHELL_CMD(clear, NULL, "Clear the trace", cmd_clear),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(i2c_trace, &sub_i2c_trace, "I2C transaction trace", NULL);
+
+#endif
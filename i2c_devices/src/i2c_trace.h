@@ -0,0 +1,37 @@
+#ifndef I2C_TRACE_H
+#define I2C_TRACE_H
+
+#include <zephyr/device.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// One I2C transfer attempt. Times are raw k_cycle_get_32() values.
+struct i2c_trace_entry {
+    const struct device *i2c_dev;
+    uint32_t start_cycles;
+    uint32_t end_cycles;
+    uint16_t len;      // Bytes moved, register address included
+    uint8_t dev_addr;
+    uint8_t reg_addr;
+    int16_t result;
+};
+
+#ifdef CONFIG_APP_I2C_TRACE
+
+// Lock-free, safe to call from any thread. Overwrites the oldest entry when full.
+void i2c_trace_record(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, size_t len,
+                      uint32_t start_cycles, uint32_t end_cycles, int result);
+
+// Copy up to max entries, oldest first. Returns the number copied.
+size_t i2c_trace_snapshot(struct i2c_trace_entry *out, size_t max);
+
+void i2c_trace_clear(void);
+
+#else
+
+static inline void i2c_trace_record(const struct device *i2c_dev, uint8_t dev_addr, uint8_t reg_addr, size_t len,
+                                    uint32_t start_cycles, uint32_t end_cycles, int result) {}
+
+#endif
+
+#endif
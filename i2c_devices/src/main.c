@@ -9,7 +9,46 @@
 #include "MPU6050.h"
 #include "MLX90614.h"
 #include "BMP280.h"
+#include "acquisition.h"
+#include "fusion.h"
+#include "i2c.h"
+#include "sensor_readout.h"
 
+// Sensors read every tick, grouped by the bus they sit on
+#ifdef CONFIG_APP_SENSOR_DRIVERS
+// The sensor devices are set up at boot from devicetree, the readers only
+// capture raw frames and sensor_readout_print() decodes them
+#define SENSOR_DEV(label) ((void *)DEVICE_DT_GET(DT_NODELABEL(label)))
+
+static const struct acq_reader i2c0_readers[] = {
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(mpu6050), okay)
+    { sensor_readout_read, MPU6050_ADDR, NULL, SENSOR_DEV(mpu6050) },
+#endif
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(mlx90614), okay)
+    { sensor_readout_read, MLX90614_ADDR, NULL, SENSOR_DEV(mlx90614) },
+#endif
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(bmp280_77), okay)
+    { sensor_readout_read, BMP280_ADDR_SECONDARY, sensor_readout_bmp280_start, SENSOR_DEV(bmp280_77) },
+#endif
+};
+static const struct acq_reader i2c1_readers[] = {
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(bmp280_76), okay)
+    { sensor_readout_read, BMP280_ADDR, sensor_readout_bmp280_start, SENSOR_DEV(bmp280_76) },
+#endif
+};
+#else
+// The BMP280 entries come last and get their instance from bmp280_init() in main()
+static struct acq_reader i2c0_readers[] = {
+    { read_mpu6050_data, MPU6050_ADDR, NULL, NULL },
+    { read_mlx90614_data, MLX90614_ADDR, NULL, NULL },
+#ifdef CONFIG_APP_BMP280_SECONDARY
+    { read_bmp280_data, BMP280_ADDR_SECONDARY, bmp280_start_measurement, NULL },
+#endif
+};
+static struct acq_reader i2c1_readers[] = {
+    { read_bmp280_data, BMP280_ADDR, bmp280_start_measurement, NULL },
+};
+#endif
 
 int main(void) {
     const struct device *i2c_dev0 = DEVICE_DT_GET(DT_NODELABEL(i2c0));
@@ -25,15 +64,42 @@ int main(void) {
         return -1;
     }
 
+#ifdef CONFIG_APP_FUSION
+    // Before mpu6050_init() so the interrupt path never runs without a consumer
+    fusion_init();
+#ifdef CONFIG_APP_SENSOR_DRIVERS
+    sensor_readout_set_mpu6050_callback(fusion_update);
+#else
+    mpu6050_set_data_callback(fusion_update);
+#endif
+#endif
+
+#ifndef CONFIG_APP_SENSOR_DRIVERS
     mpu6050_init(i2c_dev0);
-    bmp280_init(i2c_dev1);
+    i2c1_readers[0].ctx = bmp280_init(i2c_dev1, BMP280_ADDR);
+#ifdef CONFIG_APP_BMP280_SECONDARY
+    i2c0_readers[ARRAY_SIZE(i2c0_readers) - 1].ctx = bmp280_init(i2c_dev0, BMP280_ADDR_SECONDARY);
+#endif
+#endif
+
+    // Skin temperature changes slowly, let it give way to the IMU on i2c0
+    i2c_device_set_budget(i2c_dev0, MLX90614_ADDR, 5000, true);
+
+    // Each bus gets its own thread so i2c0 and i2c1 transfer in parallel
+    acq_add_bus("i2c0", i2c_dev0, i2c0_readers, ARRAY_SIZE(i2c0_readers));
+    acq_add_bus("i2c1", i2c_dev1, i2c1_readers, ARRAY_SIZE(i2c1_readers));
 
     while (1) {
-        read_mpu6050_data(i2c_dev0);
-        read_mlx90614_data(i2c_dev0);
-        read_bmp280_data(i2c_dev1);
+        acq_run_tick(K_FOREVER);
+        acq_print_cycle_times();
+#ifdef CONFIG_APP_SENSOR_DRIVERS
+        sensor_readout_print();
+#endif
+#ifdef CONFIG_APP_FUSION
+        fusion_print();
+#endif
 
-        k_msleep(1000);  
+        k_msleep(CONFIG_APP_ACQ_TICK_MS);
     }
 
     return 0;
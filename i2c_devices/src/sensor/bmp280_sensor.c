@@ -0,0 +1,162 @@
+// Zephyr sensor driver for the BMP280, see lunarvitals_sensor.h
+
+#define DT_DRV_COMPAT lunarvitals_bmp280
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/rtio/rtio.h>
+#include <errno.h>
+#include "lunarvitals_sensor.h"
+#include "../BMP280.h"
+#include "../BMP280_comp.h"
+
+#define TEMP_SHIFT  8 // degC
+#define PRESS_SHIFT 7 // kPa, 1100 hPa is 110
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= CONFIG_APP_BMP280_MAX_INSTANCES,
+             "More BMP280 nodes than CONFIG_APP_BMP280_MAX_INSTANCES");
+
+struct bmp280_sensor_config {
+    const struct device *i2c_dev;
+    uint8_t addr;
+};
+
+struct bmp280_sensor_data {
+    struct bmp280 *bmp;
+};
+
+static int bmp280_sensor_init(const struct device *dev) {
+    const struct bmp280_sensor_config *config = dev->config;
+    struct bmp280_sensor_data *data = dev->data;
+
+    if (!device_is_ready(config->i2c_dev)) {
+        return -ENODEV;
+    }
+
+    data->bmp = bmp280_init(config->i2c_dev, config->addr);
+    return data->bmp != NULL ? 0 : -EIO;
+}
+
+static void bmp280_sensor_submit(const struct device *dev, struct rtio_iodev_sqe *iodev_sqe) {
+    struct bmp280_sensor_data *data = dev->data;
+    uint8_t *buf;
+    uint32_t buf_len;
+
+    int ret = rtio_sqe_rx_buf(iodev_sqe, sizeof(struct bmp280_frame), sizeof(struct bmp280_frame), &buf, &buf_len);
+    if (ret != 0) {
+        rtio_iodev_sqe_err(iodev_sqe, ret);
+        return;
+    }
+
+    struct bmp280_frame *frame = (struct bmp280_frame *)buf;
+
+    // Until there is new data the bus is left alone and the frame comes out empty
+    frame->calib = bmp280_get_calib(data->bmp);
+    ret = bmp280_read_raw(data->bmp, &frame->raw);
+    if (ret == -EAGAIN) {
+        frame->raw.fresh = false;
+    } else if (ret != 0) {
+        rtio_iodev_sqe_err(iodev_sqe, ret);
+        return;
+    }
+
+    rtio_iodev_sqe_ok(iodev_sqe, 0);
+}
+
+struct bmp280 *lunarvitals_bmp280_get(const struct device *dev) {
+    struct bmp280_sensor_data *data = dev->data;
+
+    return data->bmp;
+}
+
+static int bmp280_decoder_get_frame_count(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                          uint16_t *frame_count) {
+    const struct bmp280_frame *frame = (const struct bmp280_frame *)buffer;
+
+    if (channel_idx != 0 || (channel != SENSOR_CHAN_AMBIENT_TEMP && channel != SENSOR_CHAN_PRESS)) {
+        return -ENOTSUP;
+    }
+
+    *frame_count = frame->raw.fresh ? 1 : 0;
+    return 0;
+}
+
+static int bmp280_decoder_get_size_info(enum sensor_channel channel, size_t *base_size, size_t *frame_size) {
+    if (channel != SENSOR_CHAN_AMBIENT_TEMP && channel != SENSOR_CHAN_PRESS) {
+        return -ENOTSUP;
+    }
+
+    *base_size = sizeof(struct sensor_q31_data);
+    *frame_size = sizeof(struct sensor_q31_sample_data);
+    return 0;
+}
+
+static int bmp280_decoder_decode(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                 uint32_t *fit, uint16_t max_count, void *data_out) {
+    const struct bmp280_frame *frame = (const struct bmp280_frame *)buffer;
+    struct sensor_q31_data *out = data_out;
+    int32_t temperature_centi_c;
+    uint32_t pressure_q24_8;
+    uint16_t frame_count;
+
+    int ret = bmp280_decoder_get_frame_count(buffer, channel, channel_idx, &frame_count);
+    if (ret != 0) {
+        return ret;
+    }
+    if (*fit >= frame_count || max_count == 0) {
+        return 0;
+    }
+
+    // Pressure needs the temperature anyway, so both come out of one call
+    ret = bmp280_compensate(CONFIG_APP_BMP280_COMP_ID, frame->calib, frame->raw.adc_T, frame->raw.adc_P,
+                            &temperature_centi_c, &pressure_q24_8);
+    if (ret != 0) {
+        return ret;
+    }
+
+    out->header.base_timestamp_ns = frame->raw.timestamp_us * NSEC_PER_USEC;
+    out->header.reading_count = 1;
+    out->readings[0].timestamp_delta = 0;
+    if (channel == SENSOR_CHAN_AMBIENT_TEMP) {
+        out->shift = TEMP_SHIFT;
+        out->readings[0].temperature = lunarvitals_centi_c_to_q31(temperature_centi_c, TEMP_SHIFT);
+    } else {
+        // Pa Q24.8 to kPa: / 256 / 1000, saturated in case of a bad calibration
+        int64_t press = ((int64_t)pressure_q24_8 << (31 - PRESS_SHIFT - 8)) / 1000;
+
+        out->shift = PRESS_SHIFT;
+        out->readings[0].pressure = (q31_t)MIN(press, INT32_MAX);
+    }
+
+    (*fit)++;
+    return 1;
+}
+
+SENSOR_DECODER_API_DT_DEFINE() = {
+    .get_frame_count = bmp280_decoder_get_frame_count,
+    .get_size_info = bmp280_decoder_get_size_info,
+    .decode = bmp280_decoder_decode,
+};
+
+static int bmp280_sensor_get_decoder(const struct device *dev, const struct sensor_decoder_api **decoder) {
+    *decoder = &SENSOR_DECODER_NAME();
+    return 0;
+}
+
+static const struct sensor_driver_api bmp280_sensor_api = {
+    .submit = bmp280_sensor_submit,
+    .get_decoder = bmp280_sensor_get_decoder,
+};
+
+#define BMP280_SENSOR_DEFINE(n)                                                         \
+    static const struct bmp280_sensor_config bmp280_sensor_config_##n = {               \
+        .i2c_dev = DEVICE_DT_GET(DT_INST_BUS(n)),                                       \
+        .addr = DT_INST_REG_ADDR(n),                                                    \
+    };                                                                                  \
+    static struct bmp280_sensor_data bmp280_sensor_data_##n;                            \
+    SENSOR_DEVICE_DT_INST_DEFINE(n, bmp280_sensor_init, NULL, &bmp280_sensor_data_##n,  \
+                                 &bmp280_sensor_config_##n, POST_KERNEL,                \
+                                 CONFIG_SENSOR_INIT_PRIORITY, &bmp280_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(BMP280_SENSOR_DEFINE)
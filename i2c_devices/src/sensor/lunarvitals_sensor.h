@@ -0,0 +1,54 @@
+#ifndef LUNARVITALS_SENSOR_H
+#define LUNARVITALS_SENSOR_H
+
+#include <zephyr/drivers/sensor.h>
+#include <stdint.h>
+#include "../MPU6050.h"
+#include "../BMP280.h"
+
+// Zephyr sensor drivers for the devicetree nodes with the lunarvitals,mpu6050,
+// lunarvitals,bmp280 and lunarvitals,mlx90614 compatibles, built with
+// CONFIG_APP_SENSOR_DRIVERS. They only implement the asynchronous read API:
+// submit() copies the registers into the RTIO buffer as one of the frames
+// below, through the same MPU6050.c, BMP280.c and MLX90614.c code the rest
+// of the app uses, and nothing is converted until a consumer decodes a
+// channel from it.
+//
+// The decoders' frame iterator is the index of the next frame, so a
+// consumer after the newest sample only can start at frame_count - 1.
+
+// MLX90614 object temperature in degC, next to SENSOR_CHAN_AMBIENT_TEMP
+#define SENSOR_CHAN_MLX90614_OBJECT_TEMP ((enum sensor_channel)SENSOR_CHAN_PRIV_START)
+
+// Every sample drained for one read: one without the FIFO, up to the FIFO size with it
+struct mpu6050_frames {
+    uint16_t count;
+    struct mpu6050_sample samples[];
+};
+
+#define MPU6050_SENSOR_MAX_FRAMES (IS_ENABLED(CONFIG_APP_MPU6050_FIFO) ? MPU6050_FIFO_MAX_SAMPLES : 1)
+#define MPU6050_SENSOR_BUF_SIZE \
+    (sizeof(struct mpu6050_frames) + MPU6050_SENSOR_MAX_FRAMES * sizeof(struct mpu6050_sample))
+
+// The calibration is the instance's own and outlives the frame
+struct bmp280_frame {
+    const struct bmp280_calib *calib;
+    struct bmp280_raw raw; // Holds no frame unless fresh
+};
+
+struct mlx90614_frame {
+    int64_t timestamp_us;
+    uint16_t ambient_raw; // 0.02 K per LSB
+    uint16_t object_raw;
+};
+
+// The BMP280.c instance behind a lunarvitals,bmp280 device, for starting its
+// conversions. NULL if the device did not initialize.
+struct bmp280 *lunarvitals_bmp280_get(const struct device *dev);
+
+// q31 value of a reading in 0.01 degC, for a channel with the given shift
+static inline q31_t lunarvitals_centi_c_to_q31(int32_t centi_c, int8_t shift) {
+    return (q31_t)((int64_t)centi_c * ((int64_t)1 << (31 - shift)) / 100);
+}
+
+#endif
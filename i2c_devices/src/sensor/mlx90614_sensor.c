@@ -0,0 +1,130 @@
+// Zephyr sensor driver for the MLX90614, see lunarvitals_sensor.h
+
+#define DT_DRV_COMPAT lunarvitals_mlx90614
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/rtio/rtio.h>
+#include <errno.h>
+#include "lunarvitals_sensor.h"
+#include "../MLX90614.h"
+
+#define TEMP_SHIFT 11 // degC, the whole 16-bit raw range of 0.02 K steps fits
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= 1, "Only one MLX90614 is supported");
+
+struct mlx90614_sensor_config {
+    const struct device *i2c_dev;
+};
+
+static int mlx90614_sensor_init(const struct device *dev) {
+    const struct mlx90614_sensor_config *config = dev->config;
+    uint16_t ambient_raw, object_raw;
+
+    if (!device_is_ready(config->i2c_dev)) {
+        return -ENODEV;
+    }
+
+    // Nothing to set up, only check the sensor answers
+    return mlx90614_read_raw(config->i2c_dev, &ambient_raw, &object_raw) == 0 ? 0 : -EIO;
+}
+
+static void mlx90614_sensor_submit(const struct device *dev, struct rtio_iodev_sqe *iodev_sqe) {
+    const struct mlx90614_sensor_config *config = dev->config;
+    uint8_t *buf;
+    uint32_t buf_len;
+
+    int ret = rtio_sqe_rx_buf(iodev_sqe, sizeof(struct mlx90614_frame), sizeof(struct mlx90614_frame), &buf,
+                              &buf_len);
+    if (ret != 0) {
+        rtio_iodev_sqe_err(iodev_sqe, ret);
+        return;
+    }
+
+    struct mlx90614_frame *frame = (struct mlx90614_frame *)buf;
+
+    frame->timestamp_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    ret = mlx90614_read_raw(config->i2c_dev, &frame->ambient_raw, &frame->object_raw);
+    if (ret != 0) {
+        rtio_iodev_sqe_err(iodev_sqe, ret);
+        return;
+    }
+
+    rtio_iodev_sqe_ok(iodev_sqe, 0);
+}
+
+static int mlx90614_decoder_get_frame_count(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                            uint16_t *frame_count) {
+    if (channel_idx != 0 ||
+        (channel != SENSOR_CHAN_AMBIENT_TEMP && channel != SENSOR_CHAN_MLX90614_OBJECT_TEMP)) {
+        return -ENOTSUP;
+    }
+
+    *frame_count = 1;
+    return 0;
+}
+
+static int mlx90614_decoder_get_size_info(enum sensor_channel channel, size_t *base_size, size_t *frame_size) {
+    if (channel != SENSOR_CHAN_AMBIENT_TEMP && channel != SENSOR_CHAN_MLX90614_OBJECT_TEMP) {
+        return -ENOTSUP;
+    }
+
+    *base_size = sizeof(struct sensor_q31_data);
+    *frame_size = sizeof(struct sensor_q31_sample_data);
+    return 0;
+}
+
+static int mlx90614_decoder_decode(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                   uint32_t *fit, uint16_t max_count, void *data_out) {
+    const struct mlx90614_frame *frame = (const struct mlx90614_frame *)buffer;
+    struct sensor_q31_data *out = data_out;
+    uint16_t frame_count;
+
+    int ret = mlx90614_decoder_get_frame_count(buffer, channel, channel_idx, &frame_count);
+    if (ret != 0) {
+        return ret;
+    }
+    if (*fit >= frame_count || max_count == 0) {
+        return 0;
+    }
+
+    // 0.02 K per LSB, so 2 * raw is in 0.01 K
+    uint16_t raw = (channel == SENSOR_CHAN_AMBIENT_TEMP) ? frame->ambient_raw : frame->object_raw;
+
+    out->header.base_timestamp_ns = frame->timestamp_us * NSEC_PER_USEC;
+    out->header.reading_count = 1;
+    out->shift = TEMP_SHIFT;
+    out->readings[0].timestamp_delta = 0;
+    out->readings[0].temperature = lunarvitals_centi_c_to_q31(2 * (int32_t)raw - 27315, TEMP_SHIFT);
+
+    (*fit)++;
+    return 1;
+}
+
+SENSOR_DECODER_API_DT_DEFINE() = {
+    .get_frame_count = mlx90614_decoder_get_frame_count,
+    .get_size_info = mlx90614_decoder_get_size_info,
+    .decode = mlx90614_decoder_decode,
+};
+
+static int mlx90614_sensor_get_decoder(const struct device *dev, const struct sensor_decoder_api **decoder) {
+    *decoder = &SENSOR_DECODER_NAME();
+    return 0;
+}
+
+static const struct sensor_driver_api mlx90614_sensor_api = {
+    .submit = mlx90614_sensor_submit,
+    .get_decoder = mlx90614_sensor_get_decoder,
+};
+
+#define MLX90614_SENSOR_DEFINE(n)                                                       \
+    BUILD_ASSERT(DT_INST_REG_ADDR(n) == MLX90614_ADDR, "MLX90614.c uses MLX90614_ADDR"); \
+    static const struct mlx90614_sensor_config mlx90614_sensor_config_##n = {           \
+        .i2c_dev = DEVICE_DT_GET(DT_INST_BUS(n)),                                       \
+    };                                                                                  \
+    SENSOR_DEVICE_DT_INST_DEFINE(n, mlx90614_sensor_init, NULL, NULL,                   \
+                                 &mlx90614_sensor_config_##n, POST_KERNEL,              \
+                                 CONFIG_SENSOR_INIT_PRIORITY, &mlx90614_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(MLX90614_SENSOR_DEFINE)
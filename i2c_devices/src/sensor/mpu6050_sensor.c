@@ -0,0 +1,198 @@
+// Zephyr sensor driver for the MPU6050, see lunarvitals_sensor.h
+
+#define DT_DRV_COMPAT lunarvitals_mpu6050
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/rtio/rtio.h>
+#include <errno.h>
+#include "lunarvitals_sensor.h"
+#include "../MPU6050.h"
+
+#define ACCEL_SHIFT 8 // m/s^2, +-16 g is 157
+#define GYRO_SHIFT  6 // rad/s, +-2000 deg/s is 35
+#define TEMP_SHIFT  8 // degC, the raw range reaches 133
+
+// q31 per LSB at +-2 g and +-250 deg/s, with 16 more fraction bits. Each
+// range step up doubles it.
+#define ACCEL_Q31_PER_LSB_Q16 ((int64_t)(9.80665 / 16384.0 * (double)(1LL << (31 - ACCEL_SHIFT + 16))))
+#define GYRO_Q31_PER_LSB_Q16 \
+    ((int64_t)(3.14159265358979 / 180.0 / 131.0 * (double)(1LL << (31 - GYRO_SHIFT + 16))))
+
+// MPU6050.c keeps its state in statics and knows one sensor only
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= 1, "Only one MPU6050 is supported");
+
+struct mpu6050_sensor_config {
+    const struct device *i2c_dev;
+};
+
+static int mpu6050_sensor_init(const struct device *dev) {
+    const struct mpu6050_sensor_config *config = dev->config;
+    struct mpu6050_sample sample;
+
+    if (!device_is_ready(config->i2c_dev)) {
+        return -ENODEV;
+    }
+
+    // mpu6050_init() only reports failures, so check the sensor answers
+    mpu6050_init(config->i2c_dev);
+    return mpu6050_read_sample(config->i2c_dev, &sample) == 0 ? 0 : -EIO;
+}
+
+static void mpu6050_sensor_submit(const struct device *dev, struct rtio_iodev_sqe *iodev_sqe) {
+    const struct mpu6050_sensor_config *config = dev->config;
+    uint8_t *buf;
+    uint32_t buf_len;
+
+    int ret = rtio_sqe_rx_buf(iodev_sqe, sizeof(struct mpu6050_frames) + sizeof(struct mpu6050_sample),
+                              MPU6050_SENSOR_BUF_SIZE, &buf, &buf_len);
+    if (ret != 0) {
+        rtio_iodev_sqe_err(iodev_sqe, ret);
+        return;
+    }
+
+    struct mpu6050_frames *frames = (struct mpu6050_frames *)buf;
+    size_t max = (buf_len - sizeof(*frames)) / sizeof(frames->samples[0]);
+
+    int n = mpu6050_capture(config->i2c_dev, frames->samples, max);
+    if (n < 0) {
+        rtio_iodev_sqe_err(iodev_sqe, n);
+        return;
+    }
+
+    frames->count = n;
+    rtio_iodev_sqe_ok(iodev_sqe, 0);
+}
+
+// Offset of a sample from the first one decoded, or false once it no longer
+// fits the 32-bit nanosecond delta. Decoding stops there and the next call
+// starts over with a new base timestamp.
+static bool timestamp_delta(const struct mpu6050_sample *first, const struct mpu6050_sample *s, uint32_t *delta_ns) {
+    uint64_t delta = (uint64_t)(s->timestamp_us - first->timestamp_us) * NSEC_PER_USEC;
+
+    if (delta > UINT32_MAX) {
+        return false;
+    }
+    *delta_ns = (uint32_t)delta;
+    return true;
+}
+
+static int mpu6050_decoder_get_frame_count(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                           uint16_t *frame_count) {
+    const struct mpu6050_frames *frames = (const struct mpu6050_frames *)buffer;
+
+    if (channel_idx != 0) {
+        return -ENOTSUP;
+    }
+
+    switch (channel) {
+    case SENSOR_CHAN_ACCEL_XYZ:
+    case SENSOR_CHAN_GYRO_XYZ:
+    case SENSOR_CHAN_DIE_TEMP:
+        *frame_count = frames->count;
+        return 0;
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static int mpu6050_decoder_get_size_info(enum sensor_channel channel, size_t *base_size, size_t *frame_size) {
+    switch (channel) {
+    case SENSOR_CHAN_ACCEL_XYZ:
+    case SENSOR_CHAN_GYRO_XYZ:
+        *base_size = sizeof(struct sensor_three_axis_data);
+        *frame_size = sizeof(struct sensor_three_axis_sample_data);
+        return 0;
+    case SENSOR_CHAN_DIE_TEMP:
+        *base_size = sizeof(struct sensor_q31_data);
+        *frame_size = sizeof(struct sensor_q31_sample_data);
+        return 0;
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static int mpu6050_decoder_decode(const uint8_t *buffer, enum sensor_channel channel, size_t channel_idx,
+                                  uint32_t *fit, uint16_t max_count, void *data_out) {
+    const struct mpu6050_frames *frames = (const struct mpu6050_frames *)buffer;
+    uint16_t frame_count;
+    int count = 0;
+
+    int ret = mpu6050_decoder_get_frame_count(buffer, channel, channel_idx, &frame_count);
+    if (ret != 0) {
+        return ret;
+    }
+    if (*fit >= frame_count || max_count == 0) {
+        return 0;
+    }
+
+    const struct mpu6050_sample *first = &frames->samples[*fit];
+
+    if (channel == SENSOR_CHAN_DIE_TEMP) {
+        struct sensor_q31_data *out = data_out;
+
+        out->header.base_timestamp_ns = first->timestamp_us * NSEC_PER_USEC;
+        out->shift = TEMP_SHIFT;
+        for (; *fit < frame_count && count < max_count; (*fit)++, count++) {
+            const struct mpu6050_sample *s = &frames->samples[*fit];
+
+            if (!timestamp_delta(first, s, &out->readings[count].timestamp_delta)) {
+                break;
+            }
+            // degC = temp / 340 + 36.53
+            out->readings[count].temperature = (q31_t)((int64_t)s->temp * (1 << (31 - TEMP_SHIFT)) / 340) +
+                                               lunarvitals_centi_c_to_q31(3653, TEMP_SHIFT);
+        }
+        out->header.reading_count = count;
+        return count;
+    }
+
+    struct sensor_three_axis_data *out = data_out;
+    bool accel = (channel == SENSOR_CHAN_ACCEL_XYZ);
+
+    out->header.base_timestamp_ns = first->timestamp_us * NSEC_PER_USEC;
+    out->shift = accel ? ACCEL_SHIFT : GYRO_SHIFT;
+    for (; *fit < frame_count && count < max_count; (*fit)++, count++) {
+        const struct mpu6050_sample *s = &frames->samples[*fit];
+        const int16_t *raw = accel ? s->accel : s->gyro;
+        // Every sample carries the range it was taken with
+        int64_t per_lsb = accel ? (ACCEL_Q31_PER_LSB_Q16 << s->accel_fs) : (GYRO_Q31_PER_LSB_Q16 << s->gyro_fs);
+
+        if (!timestamp_delta(first, s, &out->readings[count].timestamp_delta)) {
+            break;
+        }
+        for (int i = 0; i < 3; i++) {
+            out->readings[count].values[i] = (q31_t)((raw[i] * per_lsb) >> 16);
+        }
+    }
+    out->header.reading_count = count;
+    return count;
+}
+
+SENSOR_DECODER_API_DT_DEFINE() = {
+    .get_frame_count = mpu6050_decoder_get_frame_count,
+    .get_size_info = mpu6050_decoder_get_size_info,
+    .decode = mpu6050_decoder_decode,
+};
+
+static int mpu6050_sensor_get_decoder(const struct device *dev, const struct sensor_decoder_api **decoder) {
+    *decoder = &SENSOR_DECODER_NAME();
+    return 0;
+}
+
+static const struct sensor_driver_api mpu6050_sensor_api = {
+    .submit = mpu6050_sensor_submit,
+    .get_decoder = mpu6050_sensor_get_decoder,
+};
+
+#define MPU6050_SENSOR_DEFINE(n)                                                        \
+    BUILD_ASSERT(DT_INST_REG_ADDR(n) == MPU6050_ADDR, "MPU6050.c uses MPU6050_ADDR"); \
+    static const struct mpu6050_sensor_config mpu6050_sensor_config_##n = {             \
+        .i2c_dev = DEVICE_DT_GET(DT_INST_BUS(n)),                                       \
+    };                                                                                  \
+    SENSOR_DEVICE_DT_INST_DEFINE(n, mpu6050_sensor_init, NULL, NULL,                    \
+                                 &mpu6050_sensor_config_##n, POST_KERNEL,               \
+                                 CONFIG_SENSOR_INIT_PRIORITY, &mpu6050_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(MPU6050_SENSOR_DEFINE)
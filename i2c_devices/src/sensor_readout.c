@@ -0,0 +1,207 @@
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/sys/printk.h>
+#include <errno.h>
+
+#include "sensor_readout.h"
+#include "sensor/lunarvitals_sensor.h"
+
+enum readout_kind {
+    READOUT_MPU6050,
+    READOUT_BMP280,
+    READOUT_MLX90614,
+};
+
+// One sensor node: its read request, RTIO context and the frame of the last tick
+struct readout {
+    enum readout_kind kind;
+    const struct device *dev;
+    const struct device *i2c_dev;
+    struct rtio_iodev *iodev;
+    struct rtio *ctx;
+    uint8_t *buf;
+    size_t buf_size;
+    int result; // Of this tick's sensor_read(), -ENODATA if there was none
+};
+
+// The names go through one more macro so they are plain identifiers by the
+// time SENSOR_DT_READ_IODEV() and RTIO_DEFINE() paste them
+#define READOUT_STORAGE_NAMED(iodev, ctx, buf, node, size, ...)                        \
+    SENSOR_DT_READ_IODEV(iodev, node, __VA_ARGS__);                                    \
+    RTIO_DEFINE(ctx, 1, 1);                                                            \
+    static uint8_t buf[size] __aligned(8);
+
+#define READOUT_STORAGE(node, size, ...)                                               \
+    READOUT_STORAGE_NAMED(DT_CAT(node, _readout_iodev), DT_CAT(node, _readout_rtio),   \
+                          DT_CAT(node, _readout_buf), node, size, __VA_ARGS__)
+
+#define READOUT_ENTRY(node, readout_kind)                                              \
+    {                                                                                  \
+        .kind = readout_kind,                                                          \
+        .dev = DEVICE_DT_GET(node),                                                    \
+        .i2c_dev = DEVICE_DT_GET(DT_BUS(node)),                                        \
+        .iodev = &DT_CAT(node, _readout_iodev),                                        \
+        .ctx = &DT_CAT(node, _readout_rtio),                                           \
+        .buf = DT_CAT(node, _readout_buf),                                             \
+        .buf_size = sizeof(DT_CAT(node, _readout_buf)),                                \
+        .result = -ENODATA,                                                            \
+    },
+
+DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_mpu6050, READOUT_STORAGE, MPU6050_SENSOR_BUF_SIZE,
+                             SENSOR_CHAN_ACCEL_XYZ, SENSOR_CHAN_GYRO_XYZ, SENSOR_CHAN_DIE_TEMP)
+DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_bmp280, READOUT_STORAGE, sizeof(struct bmp280_frame),
+                             SENSOR_CHAN_AMBIENT_TEMP, SENSOR_CHAN_PRESS)
+DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_mlx90614, READOUT_STORAGE, sizeof(struct mlx90614_frame),
+                             SENSOR_CHAN_AMBIENT_TEMP, SENSOR_CHAN_MLX90614_OBJECT_TEMP)
+
+static mpu6050_data_cb_t mpu6050_cb;
+
+static struct readout readouts[] = {
+    DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_mpu6050, READOUT_ENTRY, READOUT_MPU6050)
+    DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_bmp280, READOUT_ENTRY, READOUT_BMP280)
+    DT_FOREACH_STATUS_OKAY_VARGS(lunarvitals_mlx90614, READOUT_ENTRY, READOUT_MLX90614)
+};
+
+void sensor_readout_read(const struct device *i2c_dev, void *ctx) {
+    for (size_t i = 0; i < ARRAY_SIZE(readouts); i++) {
+        struct readout *r = &readouts[i];
+
+        if (r->dev != ctx) {
+            continue;
+        }
+
+        r->result = sensor_read(r->iodev, r->ctx, r->buf, r->buf_size);
+        if (r->result == 0 && r->kind == READOUT_MPU6050 && mpu6050_cb != NULL) {
+            const struct mpu6050_frames *frames = (const struct mpu6050_frames *)r->buf;
+
+            if (frames->count > 0) {
+                mpu6050_cb(frames->samples, frames->count);
+            }
+        }
+        return;
+    }
+}
+
+void sensor_readout_set_mpu6050_callback(mpu6050_data_cb_t cb) {
+    mpu6050_cb = cb;
+}
+
+int sensor_readout_bmp280_start(const struct device *i2c_dev, void *ctx) {
+    const struct device *dev = ctx;
+
+    if (!device_is_ready(dev)) {
+        return -ENODEV;
+    }
+    return bmp280_start(lunarvitals_bmp280_get(dev));
+}
+
+// Decode the newest frame of one channel into out. Returns the number of
+// frames in the buffer, 0 if there is none, or a negative error.
+static int decode_newest(const struct readout *r, enum sensor_channel channel, void *out) {
+    const struct sensor_decoder_api *decoder;
+    uint16_t frame_count;
+
+    int ret = sensor_get_decoder(r->dev, &decoder);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = decoder->get_frame_count(r->buf, channel, 0, &frame_count);
+    if (ret != 0 || frame_count == 0) {
+        return ret;
+    }
+
+    // The frame iterator is the frame index, so the older frames are skipped undecoded
+    uint32_t fit = frame_count - 1;
+    ret = decoder->decode(r->buf, channel, 0, &fit, 1, out);
+    return ret < 0 ? ret : frame_count;
+}
+
+static float q31_to_float(q31_t value, int8_t shift) {
+    return (float)value / (float)(1LL << (31 - shift));
+}
+
+static void print_mpu6050(const struct readout *r) {
+    struct sensor_three_axis_data accel, gyro;
+    struct sensor_q31_data temp;
+
+    int n = decode_newest(r, SENSOR_CHAN_ACCEL_XYZ, &accel);
+    if (n <= 0 || decode_newest(r, SENSOR_CHAN_GYRO_XYZ, &gyro) <= 0 ||
+        decode_newest(r, SENSOR_CHAN_DIE_TEMP, &temp) <= 0) {
+        return;
+    }
+
+    if (IS_ENABLED(CONFIG_APP_MPU6050_FIFO)) {
+        printk("MPU6050 FIFO: %d samples\n", n);
+    }
+    printk("Accelerometer (m/s²): X=%.4f, Y=%.4f, Z=%.4f\n", q31_to_float(accel.readings[0].x, accel.shift),
+           q31_to_float(accel.readings[0].y, accel.shift), q31_to_float(accel.readings[0].z, accel.shift));
+    printk("Gyroscope (rad/s): X=%.4f, Y=%.4f, Z=%.4f\n", q31_to_float(gyro.readings[0].x, gyro.shift),
+           q31_to_float(gyro.readings[0].y, gyro.shift), q31_to_float(gyro.readings[0].z, gyro.shift));
+    printk("MPU6050 die temperature: %.2f °C\n", q31_to_float(temp.readings[0].temperature, temp.shift));
+}
+
+static void print_bmp280(const struct readout *r) {
+    struct sensor_q31_data temp, press;
+
+    // No frame until the sensor has a new conversion
+    int ret = decode_newest(r, SENSOR_CHAN_AMBIENT_TEMP, &temp);
+    if (ret == 0) {
+        return;
+    }
+    if (ret > 0) {
+        ret = decode_newest(r, SENSOR_CHAN_PRESS, &press);
+    }
+    if (ret < 0) {
+        // -ERANGE if the calibration would divide by zero
+        printk("Error: Failed to decode %s data (%d)\n", r->dev->name, ret);
+        return;
+    }
+
+    printk("%s Temperature: %.2f °C, Pressure: %.2f hPa\n", r->dev->name,
+           q31_to_float(temp.readings[0].temperature, temp.shift),
+           q31_to_float(press.readings[0].pressure, press.shift) * 10.0);
+}
+
+static void print_mlx90614(const struct readout *r) {
+    struct sensor_q31_data ambient, object;
+
+    if (decode_newest(r, SENSOR_CHAN_AMBIENT_TEMP, &ambient) <= 0 ||
+        decode_newest(r, SENSOR_CHAN_MLX90614_OBJECT_TEMP, &object) <= 0) {
+        return;
+    }
+
+    printk("Ambient Temperature: %.2f °C\n", q31_to_float(ambient.readings[0].temperature, ambient.shift));
+    printk("Object Temperature: %.2f °C\n", q31_to_float(object.readings[0].temperature, object.shift));
+}
+
+void sensor_readout_print(void) {
+    for (size_t i = 0; i < ARRAY_SIZE(readouts); i++) {
+        struct readout *r = &readouts[i];
+        int result = r->result;
+
+        // Cleared so a sensor skipped next tick, e.g. by the bus budget, is not printed twice
+        r->result = -ENODATA;
+        if (result == -ENODATA) {
+            continue;
+        }
+        if (result != 0) {
+            printk("Error: Failed to read %s (%d)\n", r->dev->name, result);
+            continue;
+        }
+
+        switch (r->kind) {
+        case READOUT_MPU6050:
+            print_mpu6050(r);
+            break;
+        case READOUT_BMP280:
+            print_bmp280(r);
+            break;
+        case READOUT_MLX90614:
+            print_mlx90614(r);
+            break;
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef SENSOR_READOUT_H
+#define SENSOR_READOUT_H
+
+#include <zephyr/device.h>
+#include "MPU6050.h"
+
+// Consumer of the CONFIG_APP_SENSOR_DRIVERS sensor devices. The acquisition
+// readers only run sensor_read() into a raw frame buffer per devicetree node;
+// the frames are decoded by sensor_readout_print(), for the channels it shows,
+// once the tick is over.
+
+// Acquisition reader capturing the sensor device in ctx
+void sensor_readout_read(const struct device *i2c_dev, void *ctx);
+// Called from the reader with the MPU6050 samples of every capture, like
+// mpu6050_set_data_callback() without the sensor drivers
+void sensor_readout_set_mpu6050_callback(mpu6050_data_cb_t cb);
+// Acquisition start hook for a lunarvitals,bmp280 device in ctx
+int sensor_readout_bmp280_start(const struct device *i2c_dev, void *ctx);
+
+// Decode and print the frames of the last tick. Must not overlap a tick.
+void sensor_readout_print(void);
+
+#endif
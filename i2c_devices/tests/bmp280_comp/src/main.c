@@ -0,0 +1,49 @@
+// Cost and accuracy of the three BMP280 compensation variants, on the
+// datasheet calibration across the operating range
+
+#include <zephyr/ztest.h>
+#include "BMP280_comp.h"
+
+#define BENCH_SAMPLES 10000
+
+static const char *const names[] = { "int64", "int32", "float" };
+
+// Worst error allowed against the double precision formula. The integer
+// variants output 0.01 degC steps, and the 32-bit one whole pascals.
+static const uint32_t max_temp_err_mc[] = { 10, 10, 10 };
+static const uint32_t max_press_err_mpa[] = { 1000, 10000, 500 };
+
+ZTEST_SUITE(bmp280_comp, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(bmp280_comp, test_benchmark) {
+    struct bmp280_comp_bench bench[BMP280_COMP_COUNT];
+
+    bmp280_comp_benchmark(&bmp280_datasheet_calib, BENCH_SAMPLES, bench);
+
+    TC_PRINT("impl   cycles/sample  ns/sample  max err mdegC  max err mPa\n");
+    for (int comp = 0; comp < BMP280_COMP_COUNT; comp++) {
+        TC_PRINT("%-5s  %13u  %9u  %13u  %11u\n", names[comp], bench[comp].cycles_per_sample,
+                 bench[comp].ns_per_sample, bench[comp].max_temp_err_mc, bench[comp].max_press_err_mpa);
+    }
+
+    for (int comp = 0; comp < BMP280_COMP_COUNT; comp++) {
+        zassert_equal(bench[comp].samples, BENCH_SAMPLES);
+        zassert_true(bench[comp].max_temp_err_mc <= max_temp_err_mc[comp], "%s temperature off by %u mdegC",
+                     names[comp], bench[comp].max_temp_err_mc);
+        zassert_true(bench[comp].max_press_err_mpa <= max_press_err_mpa[comp], "%s pressure off by %u mPa",
+                     names[comp], bench[comp].max_press_err_mpa);
+    }
+}
+
+// The datasheet's worked example, section 3.12: 25.08 degC and 100653.27 Pa
+ZTEST(bmp280_comp, test_datasheet_example) {
+    for (int comp = 0; comp < BMP280_COMP_COUNT; comp++) {
+        int32_t temperature_centi_c;
+        uint32_t pressure_q24_8;
+
+        zassert_ok(bmp280_compensate(comp, &bmp280_datasheet_calib, 519888, 415148, &temperature_centi_c,
+                                     &pressure_q24_8));
+        zassert_within(temperature_centi_c, 2508, 1, "%s: %d", names[comp], temperature_centi_c);
+        zassert_within(pressure_q24_8 / 256.0, 100653.27, 6.0, "%s: %u", names[comp], pressure_q24_8);
+    }
+}
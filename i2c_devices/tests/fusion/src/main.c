@@ -0,0 +1,94 @@
+// Madgwick filter on synthetic samples: tilt from the accelerometer when the
+// samples are too far apart to integrate, gyro integration when they are not
+
+#include <zephyr/ztest.h>
+#include <math.h>
+#include "fusion.h"
+
+#define DEG_TO_RAD 0.017453293f
+
+#define LSB_PER_G     16384 // +-2 g
+#define LSB_PER_DPS   131   // +-250 deg/s
+#define POLL_US       1000000
+#define STREAM_US     5000 // 200 Hz
+
+static int64_t now_us;
+
+// A still sensor at the given roll and pitch, optionally turning about Z
+static void feed(int64_t dt_us, float roll_deg, float pitch_deg, float yaw_rate_dps) {
+    float roll = roll_deg * DEG_TO_RAD, pitch = pitch_deg * DEG_TO_RAD;
+    struct mpu6050_sample sample = {
+        .accel_fs = MPU6050_ACCEL_FS_2G,
+        .gyro_fs = MPU6050_GYRO_FS_250DPS,
+    };
+
+    now_us += dt_us;
+    sample.timestamp_us = now_us;
+    sample.accel[0] = (int16_t)lroundf(-sinf(pitch) * LSB_PER_G);
+    sample.accel[1] = (int16_t)lroundf(sinf(roll) * cosf(pitch) * LSB_PER_G);
+    sample.accel[2] = (int16_t)lroundf(cosf(roll) * cosf(pitch) * LSB_PER_G);
+    sample.gyro[2] = (int16_t)lroundf(yaw_rate_dps * LSB_PER_DPS);
+    fusion_update(&sample, 1);
+}
+
+static void assert_euler(float roll_deg, float pitch_deg, float yaw_deg, float tolerance_deg) {
+    float q[4], euler[3];
+
+    fusion_get_quaternion(q);
+    zassert_within(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1.0f, 0.001f, "not a unit quaternion");
+
+    fusion_get_euler(euler);
+    zassert_within(euler[0], roll_deg, tolerance_deg, "roll %f", (double)euler[0]);
+    zassert_within(euler[1], pitch_deg, tolerance_deg, "pitch %f", (double)euler[1]);
+    zassert_within(euler[2], yaw_deg, tolerance_deg, "yaw %f", (double)euler[2]);
+}
+
+static void fusion_before(void *fixture) {
+    fusion_init();
+    now_us = 0;
+}
+
+ZTEST_SUITE(fusion, NULL, NULL, fusion_before, NULL, NULL);
+
+// Polled acquisition: every sample is a gap, so the tilt follows the accelerometer
+ZTEST(fusion, test_polled_tilt) {
+    struct fusion_stats stats;
+
+    feed(POLL_US, 30.0f, 0.0f, 0.0f);
+    assert_euler(30.0f, 0.0f, 0.0f, 0.2f);
+
+    feed(POLL_US, 0.0f, 20.0f, 0.0f);
+    assert_euler(0.0f, 20.0f, 0.0f, 0.2f);
+
+    feed(POLL_US, -15.0f, -40.0f, 0.0f);
+    assert_euler(-15.0f, -40.0f, 0.0f, 0.2f);
+
+    fusion_get_stats(&stats);
+    zassert_equal(stats.updates, 3);
+}
+
+// A gap resets the tilt and keeps the heading the gyro integrated
+ZTEST(fusion, test_gap_keeps_heading) {
+    feed(POLL_US, 0.0f, 0.0f, 0.0f);
+
+    // 45 deg/s for 2 s
+    for (int i = 0; i < 400; i++) {
+        feed(STREAM_US, 0.0f, 0.0f, 45.0f);
+    }
+    assert_euler(0.0f, 0.0f, 90.0f, 1.0f);
+
+    feed(POLL_US, 0.0f, 20.0f, 0.0f);
+    assert_euler(0.0f, 20.0f, 90.0f, 1.0f);
+}
+
+// Samples with the same timestamp are not integrated twice
+ZTEST(fusion, test_repeated_timestamp) {
+    float before[4], after[4];
+
+    feed(POLL_US, 10.0f, 0.0f, 0.0f);
+    fusion_get_quaternion(before);
+    feed(0, 0.0f, 0.0f, 200.0f);
+    fusion_get_quaternion(after);
+
+    zassert_mem_equal(before, after, sizeof(before));
+}
@@ -0,0 +1,145 @@
+// The async I2C queue against the MPU6050 emulator, which takes the bus time
+// a real transfer takes at 100 kHz (CONFIG_APP_EMUL_BUS_TIME). The work a main
+// loop does between reads, compensation and output, is a busy wait here, so
+// the time it gets back from queueing its reads can be measured.
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include "MPU6050.h"
+#include "i2c.h"
+#include "i2c_async.h"
+
+#define MPU6050_NODE DT_NODELABEL(mpu6050)
+
+#define ITERATIONS 50
+#define WORK_US    1000 // Less than the 1.5 ms a 14-byte read takes on the bus
+
+static const struct device *const i2c_dev = DEVICE_DT_GET(DT_BUS(MPU6050_NODE));
+static uint8_t data[MPU6050_SAMPLE_SIZE];
+
+static void main_loop_work(void) {
+    k_busy_wait(WORK_US);
+}
+
+// Read, then work, the way the blocking helpers force a loop to run
+static uint32_t run_blocking(void) {
+    uint32_t start = k_cycle_get_32();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        zassert_ok(i2c_read_registers(i2c_dev, MPU6050_ADDR, ACCEL_XOUT_H, data, sizeof(data)));
+        main_loop_work();
+    }
+    return k_cyc_to_us_floor32(k_cycle_get_32() - start);
+}
+
+// Queue the read, work while it is on the bus, then pick up the result
+static uint32_t run_async(void) {
+    struct i2c_async_txn txn;
+    uint32_t start = k_cycle_get_32();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        i2c_async_read_init(&txn, i2c_dev, MPU6050_ADDR, ACCEL_XOUT_H, data, sizeof(data), NULL, NULL);
+        zassert_ok(i2c_async_submit(&txn));
+        main_loop_work();
+        zassert_ok(i2c_async_wait(&txn, K_FOREVER));
+    }
+    return k_cyc_to_us_floor32(k_cycle_get_32() - start);
+}
+
+static void *i2c_async_setup(void) {
+    zassert_true(device_is_ready(i2c_dev));
+
+    mpu6050_init(i2c_dev);
+    return NULL;
+}
+
+ZTEST_SUITE(i2c_async, NULL, i2c_async_setup, NULL, NULL, NULL);
+
+ZTEST(i2c_async, test_reclaimed_cpu) {
+    uint32_t blocking_us = run_blocking();
+    uint32_t async_us = run_async();
+    uint32_t bus_us = (blocking_us - ITERATIONS * WORK_US) / ITERATIONS;
+    uint32_t reclaimed_us = blocking_us > async_us ? blocking_us - async_us : 0;
+
+    TC_PRINT("%d reads of %u us and %d us of work: blocking %u us, async %u us\n", ITERATIONS, bus_us,
+             WORK_US, blocking_us, async_us);
+    TC_PRINT("CPU time given back to the loop: %u us (%u%% of the bus time)\n", reclaimed_us,
+             reclaimed_us * 100 / (ITERATIONS * bus_us));
+
+    zassert_true(bus_us > WORK_US, "emulated bus time missing (%u us per read)", bus_us);
+    // The work is shorter than a read, so all of it should hide behind the bus
+    zassert_true(reclaimed_us >= ITERATIONS * WORK_US * 9 / 10, "only %u us reclaimed", reclaimed_us);
+}
+
+static void count_cb(struct i2c_async_txn *txn, int result, void *user_data) {
+    atomic_inc((atomic_t *)user_data);
+}
+
+ZTEST(i2c_async, test_callback_and_poll) {
+    struct i2c_async_txn txn;
+    atomic_t calls = ATOMIC_INIT(0);
+    uint8_t who_am_i = 0;
+    int result = -1;
+
+    i2c_async_read_init(&txn, i2c_dev, MPU6050_ADDR, DEVICE_ID, &who_am_i, 1, count_cb, &calls);
+    zassert_ok(i2c_async_submit(&txn));
+    // Started by the higher-priority worker straight away and now on the bus
+    zassert_equal(i2c_async_submit(&txn), -EBUSY);
+    zassert_false(i2c_async_poll(&txn, &result));
+
+    while (!i2c_async_poll(&txn, &result)) {
+        k_usleep(100);
+    }
+    zassert_ok(result);
+    zassert_equal(atomic_get(&calls), 1);
+    zassert_equal(who_am_i, 0x68);
+}
+
+ZTEST(i2c_async, test_cancel) {
+    struct i2c_async_txn first, second;
+    uint8_t buf[2][MPU6050_SAMPLE_SIZE];
+
+    i2c_async_read_init(&first, i2c_dev, MPU6050_ADDR, ACCEL_XOUT_H, buf[0], sizeof(buf[0]), NULL, NULL);
+    i2c_async_read_init(&second, i2c_dev, MPU6050_ADDR, ACCEL_XOUT_H, buf[1], sizeof(buf[1]), NULL, NULL);
+    zassert_ok(i2c_async_submit(&first));
+    zassert_ok(i2c_async_submit(&second));
+
+    // The first one is on the bus, the second still queued behind it
+    zassert_equal(i2c_async_cancel(&first), -EINPROGRESS);
+    zassert_ok(i2c_async_cancel(&second));
+    zassert_equal(i2c_async_wait(&second, K_NO_WAIT), -ECANCELED);
+
+    zassert_ok(i2c_async_wait(&first, K_FOREVER));
+    zassert_equal(i2c_async_cancel(&first), -EALREADY);
+}
+
+ZTEST(i2c_async, test_fifo_drain) {
+    static struct mpu6050_sample samples[MPU6050_FIFO_MAX_SAMPLES];
+    int64_t period_us = USEC_PER_SEC / CONFIG_APP_MPU6050_FIFO_RATE_HZ;
+    float accel_g[3], gyro_dps[3];
+
+    // Empty it first, then let half a second of samples in: more than ten
+    // chunks, decoded while the next one is read through the queue
+    zassert_true(mpu6050_fifo_read(i2c_dev, samples, ARRAY_SIZE(samples)) >= 0);
+    k_msleep(500);
+    int n = mpu6050_fifo_read(i2c_dev, samples, ARRAY_SIZE(samples));
+
+    zassert_true(n >= CONFIG_APP_MPU6050_FIFO_RATE_HZ / 2 - 1, "%d samples", n);
+    zassert_true(n * MPU6050_FIFO_SAMPLE_SIZE > 10 * I2C_MAX_READ_LEN);
+    for (int i = 0; i < n; i++) {
+        // A still sensor, 1 g on Z and no rotation
+        mpu6050_accel_to_g(&samples[i], accel_g);
+        mpu6050_gyro_to_dps(&samples[i], gyro_dps);
+        zassert_within(accel_g[0], 0.0f, 0.01f, "sample %d", i);
+        zassert_within(accel_g[1], 0.0f, 0.01f, "sample %d", i);
+        zassert_within(accel_g[2], 1.0f, 0.01f, "sample %d", i);
+        for (int axis = 0; axis < 3; axis++) {
+            zassert_within(gyro_dps[axis], 0.0f, 0.1f, "sample %d", i);
+        }
+        if (i > 0) {
+            zassert_equal(samples[i].timestamp_us - samples[i - 1].timestamp_us, period_us);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+// Bias calibration into the offset registers, saved through settings/NVS on
+// the flash simulator and restored by mpu6050_init()
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <string.h>
+#include "MPU6050.h"
+
+#define MPU6050_NODE  DT_NODELABEL(mpu6050)
+#define CALIB_SAMPLES 200
+
+// Non-zero in the moving scenario, see moving.overlay
+#define GYRO_AMPLITUDE_MDPS DT_PROP(MPU6050_NODE, gyro_amplitude_mdps)
+
+static const struct device *const i2c_dev = DEVICE_DT_GET(DT_BUS(MPU6050_NODE));
+
+// What the offset registers held at power up
+static struct mpu6050_offsets factory;
+
+static int load_direct(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) {
+    struct mpu6050_offsets *out = param;
+
+    if (!settings_name_steq(key, "offsets", NULL) || len != sizeof(*out)) {
+        return 0;
+    }
+    return read_cb(cb_arg, out, sizeof(*out)) == sizeof(*out) ? 0 : -EIO;
+}
+
+static void assert_still(void) {
+    struct mpu6050_sample sample;
+    float accel_g[3], gyro_dps[3];
+
+    zassert_ok(mpu6050_read_sample(i2c_dev, &sample));
+    mpu6050_accel_to_g(&sample, accel_g);
+    mpu6050_gyro_to_dps(&sample, gyro_dps);
+
+    // Offset registers step 0.5 mg (1 mg for accel, bit 0 is reserved) and 30 mdps
+    zassert_within(accel_g[0], 0.0f, 0.002f, "accel X %f g", (double)accel_g[0]);
+    zassert_within(accel_g[1], 0.0f, 0.002f, "accel Y %f g", (double)accel_g[1]);
+    zassert_within(accel_g[2], 1.0f, 0.002f, "accel Z %f g", (double)accel_g[2]);
+    for (int axis = 0; axis < 3; axis++) {
+        zassert_within(gyro_dps[axis], 0.0f, 0.05f, "gyro %d %f deg/s", axis, (double)gyro_dps[axis]);
+    }
+}
+
+static void *calib_setup(void) {
+    zassert_true(device_is_ready(i2c_dev));
+
+    // Nothing saved yet, the offsets stay at the factory values
+    mpu6050_init(i2c_dev);
+    zassert_ok(mpu6050_get_offsets(i2c_dev, &factory));
+    return NULL;
+}
+
+ZTEST_SUITE(mpu6050_calib, NULL, calib_setup, NULL, NULL, NULL);
+
+ZTEST(mpu6050_calib, test_calibrate_save_restore) {
+    struct mpu6050_offsets calibrated, saved = { 0 }, restored;
+    struct mpu6050_sample sample;
+    float gyro_dps[3];
+
+    if (GYRO_AMPLITUDE_MDPS != 0) {
+        ztest_test_skip();
+    }
+
+    // The bias from the overlay shows up before calibration
+    zassert_ok(mpu6050_read_sample(i2c_dev, &sample));
+    mpu6050_gyro_to_dps(&sample, gyro_dps);
+    zassert_within(gyro_dps[0], 1.8f, 0.05f);
+
+    uint16_t rate_hz = mpu6050_get_sample_rate();
+    zassert_ok(mpu6050_calibrate(i2c_dev, CALIB_SAMPLES));
+    zassert_equal(mpu6050_get_sample_rate(), rate_hz, "polled rate not restored");
+    zassert_ok(mpu6050_get_offsets(i2c_dev, &calibrated));
+    zassert_true(memcmp(&calibrated, &factory, sizeof(factory)) != 0);
+    assert_still();
+
+    // Saved to flash, not only kept in RAM
+    zassert_ok(settings_load_subtree_direct("mpu6050", load_direct, &saved));
+    zassert_mem_equal(&saved, &calibrated, sizeof(saved));
+
+    // Power cycle: the chip comes back with its factory offsets, and init
+    // has to load them from flash again
+    zassert_ok(mpu6050_set_offsets(i2c_dev, &factory));
+    mpu6050_init(i2c_dev);
+    zassert_ok(mpu6050_get_offsets(i2c_dev, &restored));
+    zassert_mem_equal(&restored, &calibrated, sizeof(restored));
+    assert_still();
+}
+
+ZTEST(mpu6050_calib, test_calibrate_rejects_bad_args) {
+    zassert_equal(mpu6050_calibrate(i2c_dev, 0), -EINVAL);
+    zassert_equal(mpu6050_calibrate(i2c_dev, 2001), -EINVAL);
+}
+
+ZTEST(mpu6050_calib, test_calibrate_rejects_motion) {
+    struct mpu6050_offsets before, after;
+
+    if (GYRO_AMPLITUDE_MDPS == 0) {
+        ztest_test_skip();
+    }
+
+    uint16_t rate_hz = mpu6050_get_sample_rate();
+    zassert_ok(mpu6050_get_offsets(i2c_dev, &before));
+    zassert_equal(mpu6050_calibrate(i2c_dev, CALIB_SAMPLES), -EAGAIN);
+
+    // Nothing applied, and the polled rate is back even though it failed
+    zassert_ok(mpu6050_get_offsets(i2c_dev, &after));
+    zassert_mem_equal(&after, &before, sizeof(after));
+    zassert_equal(mpu6050_get_sample_rate(), rate_hz);
+}
@@ -0,0 +1,163 @@
+// DMP packet parsing against the emulator's DMP model (src/emul/mpu6050_emul.c):
+// the quaternion turns about Z once per period, each packet by its own sample
+// time at CONFIG_APP_MPU6050_DMP_RATE_HZ, the raw accel and gyro are
+// those of a still sensor, every 50th packet carries a tap on +Z and every
+// 200th an orientation change.
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <math.h>
+#include "MPU6050.h"
+#include "MPU6050_dmp.h"
+
+#define MPU6050_NODE DT_NODELABEL(mpu6050)
+#define PERIOD_MS    DT_PROP(MPU6050_NODE, period_ms)
+#define STEP_MS      (PERIOD_MS / 8 + 3)
+
+#define TAP_EVERY    50
+#define ORIENT_EVERY 200
+
+#define TWO_PI 6.283185307179586
+
+#define PACKET_US   (USEC_PER_SEC / CONFIG_APP_MPU6050_DMP_RATE_HZ)
+#define ANGLE_TOL   0.001 // rad
+
+#define Q30_ONE     (1 << 30)
+#define Q30_TOL     (Q30_ONE / 1000)
+#define ACCEL_1G_2G 16384 // LSB per g at +-2 g, the range the DMP fixes
+
+// The emulator always sends every packet part. The layout_mismatch scenario
+// leaves one out of the options, and init has to refuse the image.
+#define EMUL_PACKET_SIZE (DMP_QUAT_SIZE + DMP_ACCEL_SIZE + DMP_GYRO_SIZE + DMP_GESTURE_SIZE)
+#define LAYOUT_MATCHES   (MPU6050_DMP_PACKET_SIZE == EMUL_PACKET_SIZE)
+
+static const struct device *const i2c_dev = DEVICE_DT_GET(DT_BUS(MPU6050_NODE));
+static struct mpu6050_dmp_packet packets[MPU6050_FIFO_SIZE / MPU6050_DMP_PACKET_SIZE];
+
+// Packets taken out of the FIFO so far, the emulator numbers its gestures the same way
+static uint32_t packets_read;
+
+static int dmp_read(void) {
+    int n = mpu6050_dmp_read(i2c_dev, packets, ARRAY_SIZE(packets));
+
+    zassert_true(n >= 0, "mpu6050_dmp_read() failed (%d)", n);
+    packets_read += n;
+    return n;
+}
+
+// Rotation about Z of a packet, in [0, 2pi)
+static double packet_angle(const struct mpu6050_dmp_packet *p) {
+    double angle = 2.0 * atan2((double)p->quat[3], (double)p->quat[0]);
+
+    return angle < 0.0 ? angle + TWO_PI : angle;
+}
+
+// Turn from one angle to the next, in [-pi, pi)
+static double angle_step(double from, double to) {
+    return fmod(to - from + 3.0 * TWO_PI / 2.0, TWO_PI) - TWO_PI / 2.0;
+}
+
+static void *dmp_setup(void) {
+    zassert_true(device_is_ready(i2c_dev));
+
+    // Uploads the test image, verifies it, starts the DMP and checks its packet size
+    mpu6050_init(i2c_dev);
+    return NULL;
+}
+
+ZTEST_SUITE(mpu6050_dmp, NULL, dmp_setup, NULL, NULL, NULL);
+
+ZTEST(mpu6050_dmp, test_packet_size_checked) {
+    zassert_equal(mpu6050_dmp_enabled(), LAYOUT_MATCHES, "%u byte packets from the image, %u configured",
+                  EMUL_PACKET_SIZE, MPU6050_DMP_PACKET_SIZE);
+}
+
+ZTEST(mpu6050_dmp, test_quaternion) {
+    double prev_angle = 0.0;
+    bool have_prev = false;
+
+    if (!LAYOUT_MATCHES) {
+        ztest_test_skip();
+    }
+
+    // Steps shorter than the 320 ms it takes the DMP to fill the FIFO, so
+    // no packet is lost between reads
+    for (int step = 0; step < 8; step++) {
+        k_msleep(STEP_MS);
+        int n = dmp_read();
+
+        zassert_true(n > 1, "%d packets after %d ms", n, STEP_MS);
+        for (int i = 0; i < n; i++) {
+            const struct mpu6050_dmp_packet *p = &packets[i];
+            double angle = packet_angle(p);
+
+            zassert_within(p->quat[1], 0, Q30_TOL);
+            zassert_within(p->quat[2], 0, Q30_TOL);
+            zassert_within(p->quat[0], (int32_t)(cos(angle / 2) * Q30_ONE), Q30_TOL, "not unit length");
+
+            zassert_equal(p->accel[0], 0);
+            zassert_equal(p->accel[1], 0);
+            zassert_equal(p->accel[2], ACCEL_1G_2G);
+            for (int axis = 0; axis < 3; axis++) {
+                zassert_equal(p->gyro[axis], 0);
+            }
+
+            // Oldest first, each turned on from the one before by the time
+            // between their timestamps. The first of a read carries on from
+            // the last of the previous one.
+            if (i > 0) {
+                int64_t dt_us = p->timestamp_us - packets[i - 1].timestamp_us;
+
+                zassert_equal(dt_us, PACKET_US, "packet %d", i);
+                zassert_within(angle_step(prev_angle, angle), TWO_PI * dt_us / (PERIOD_MS * 1000.0), ANGLE_TOL,
+                               "packet %d of step %d turned %f rad", i, step, angle_step(prev_angle, angle));
+            } else if (have_prev) {
+                zassert_within(angle_step(prev_angle, angle), TWO_PI * PACKET_US / (PERIOD_MS * 1000.0), ANGLE_TOL,
+                               "step %d does not carry on from the last", step);
+            }
+            prev_angle = angle;
+            have_prev = true;
+        }
+    }
+}
+
+ZTEST(mpu6050_dmp, test_gestures) {
+    uint32_t taps = 0, orientations = 0;
+
+    if (!LAYOUT_MATCHES) {
+        ztest_test_skip();
+    }
+
+    // Past two orientation changes, read often enough that the FIFO never overflows
+    while (orientations < 2) {
+        uint32_t first = packets_read + 1;
+
+        k_msleep(50);
+        int n = dmp_read();
+
+        for (int i = 0; i < n; i++) {
+            const struct mpu6050_dmp_packet *p = &packets[i];
+            uint32_t index = first + i;
+
+            if (index % TAP_EVERY == 0) {
+                zassert_equal(p->tap_dir, MPU6050_TAP_Z_UP, "packet %u", index);
+                zassert_equal(p->tap_count, 1, "packet %u", index);
+                taps++;
+            } else {
+                zassert_equal(p->tap_dir, MPU6050_TAP_NONE, "packet %u", index);
+                zassert_equal(p->tap_count, 0, "packet %u", index);
+            }
+
+            if (index % ORIENT_EVERY == 0) {
+                zassert_equal(p->orientation, (index / ORIENT_EVERY) % 4, "packet %u", index);
+                orientations++;
+            } else {
+                zassert_equal(p->orientation, MPU6050_ORIENT_NONE, "packet %u", index);
+            }
+        }
+    }
+
+    zassert_true(taps >= 2 * ORIENT_EVERY / TAP_EVERY);
+}